@@ -0,0 +1,60 @@
+#pragma once
+
+/*
+Counts heap allocations made through global operator new.
+
+Include this header in exactly one translation unit of a benchmark program: it replaces the global
+allocation functions with versions that bump a counter before calling malloc. Read the counter with
+allocationCount() before and after the code under test.
+*/
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+inline std::atomic<uint64_t> allocationCounter{0};
+
+inline uint64_t allocationCount()
+{
+    return allocationCounter.load(std::memory_order_relaxed);
+}
+
+namespace allocation_counter_detail {
+
+inline void* allocate(std::size_t size)
+{
+    allocationCounter.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+inline void* allocateAligned(std::size_t size, std::align_val_t alignment)
+{
+    allocationCounter.fetch_add(1, std::memory_order_relaxed);
+    std::size_t align = static_cast<std::size_t>(alignment);
+    std::size_t rounded = (size + align - 1) / align * align;
+    if (void* p = std::aligned_alloc(align, rounded ? rounded : align)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+} // namespace allocation_counter_detail
+
+void* operator new(std::size_t size) { return allocation_counter_detail::allocate(size); }
+void* operator new[](std::size_t size) { return allocation_counter_detail::allocate(size); }
+void* operator new(std::size_t size, std::align_val_t a) { return allocation_counter_detail::allocateAligned(size, a); }
+void* operator new[](std::size_t size, std::align_val_t a) { return allocation_counter_detail::allocateAligned(size, a); }
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
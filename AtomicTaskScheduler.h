@@ -0,0 +1,330 @@
+#pragma once
+
+/*
+An atomic task scheduler ensures that tasks are executed at specific times with thread safety and no overlapping execution. Below is an implementation of an atomic task scheduler in C++, leveraging std::thread, std::mutex, and std::condition_variable for concurrency and synchronization
+
+Explanation
+1.	Task Structure:
+•	Each task has a function (func) to execute and a time point (executeAt) indicating when it should run.
+•	func is an InplaceTask (InplaceTask.h): a move-only callable that keeps captures of up to 56 bytes inline, so scheduling a task does not allocate and a due task is moved out of the heap, never copied.
+•	A min-heap is used to manage tasks, with the earliest task at the top.
+2.	Scheduler Thread:
+•	Continuously checks the task queue for tasks ready to execute.
+•	Waits until the next task's execution time or until a new task is added that is due before then.
+•	Slack: schedule(func, time, slack) lets a task run anywhere in [time, time + slack]. Timers are ordered by time + slack, the thread sleeps until the earliest of those and then runs every task that is already due, so timers that are close together share one wakeup. A task never runs early.
+•	WaitMode::TimerFd makes the thread sleep on a timerfd instead of the condition variable (TimerWait.h).
+3.	Thread Safety:
+•	A mutex ensures thread-safe access to the task queue.
+•	A condition_variable is used to notify the scheduler thread when new tasks are added.
+4.	Task Scheduling:
+•	schedule: Schedules a task to run at a specific time.
+•	scheduleAfter: Schedules a task to run after a delay (in milliseconds).
+•	Both return a TimerHandle whose cancel() and reschedule() take O(log n): the task store is an indexed heap (TimerQueue.h), so a cancelled task is removed and destroyed at once instead of lingering until its time.
+•	schedulePeriodic: Runs a task every period until its handle is cancelled. FixedRate keeps the runs on the grid first + k * period and makes up missed runs back to back; FixedRateSkip stays on the grid but drops missed runs; FixedDelay waits one period after each run finishes. Due times are computed from the grid, not from when the callback happened to run, so fixed-rate tasks do not drift. The task is stored once and re-armed in place (TimerQueue::detachDue / rearm), so a tick allocates nothing.
+5.	Worker Pool Mode:
+•	AtomicTaskScheduler(workerCount) with workerCount > 0 makes the scheduler thread a pure timer: it only detects due tasks and hands them to a WorkStealingPool (WorkStealingPool.h).
+•	Each worker owns a Chase-Lev deque and steals from the others when idle, so a slow task no longer delays later deadlines and throughput scales with cores.
+•	Tasks may then run concurrently; workerStats() reports executed, stolen and parked counts per worker.
+6.	Coroutines:
+•	co_await scheduler.sleepFor(d) suspends a coroutine until d has passed; it is an ordinary one-shot task that resumes the coroutine, through an Executor of the caller's choice (Coroutines.h).
+7.	Metrics:
+•	Built with -DCONCURRENCY_METRICS=1, the scheduler records dispatch lateness, queue depth, execution time of tasks it runs itself (inline tasks and periodic runs) and its wakeups into Metrics (Metrics.h); Metrics::snapshot() reads them at any time. Without the flag the calls compile to nothing.
+Key Features
+1.	Atomic Execution: Tasks are executed one at a time in the order of their scheduled time.
+2.	Concurrency: The scheduler runs in a separate thread.
+3.	Thread Safety: Uses mutex and condition_variable for safe access to shared resources.
+4.	Flexible Scheduling: Supports scheduling tasks at specific times or after delays.
+---
+Complexity
+•	Task Scheduling: O(log n) for adding tasks to the priority queue.
+•	Cancel / Reschedule: O(log n).
+•	Task Execution: O(1) for executing the top task.
+•	Space Complexity: O(n), where n is the number of tasks in the queue.
+This implementation is efficient and ensures atomic execution of tasks.
+
+*/
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Coroutines.h"
+#include "InplaceTask.h"
+#include "Metrics.h"
+#include "TimerQueue.h"
+#include "TimerWait.h"
+#include "WorkStealingPool.h"
+
+class AtomicTaskScheduler {
+public:
+    // How a periodic task picks its next run
+    enum class Recurrence {
+        FixedRate,     // Every period from the first due time; missed runs are made up back to back
+        FixedRateSkip, // Every period from the first due time; missed runs are skipped
+        FixedDelay     // One period after the previous run finished
+    };
+
+private:
+    struct Task {
+        InplaceTask<> func; // The task to execute; captures up to 56 bytes are stored inline
+        std::chrono::steady_clock::duration period{}; // Zero for one-shot tasks
+        Recurrence mode = Recurrence::FixedRate;
+        std::chrono::time_point<std::chrono::steady_clock> due{}; // When the current run was due
+        bool cancelled = false; // Cancelled while running; released when the run finishes
+        TimerQueue<Task>::TimerId id{}; // Own id, so a pool job only needs to capture the task
+        std::chrono::steady_clock::duration slack{}; // May run this much after it is due; its heap key is due + slack
+    };
+
+    using Timers = TimerQueue<Task>;
+
+    Timers taskQueue; // Indexed min-heap for tasks by due time + slack, so pending tasks can be cancelled or moved
+    std::mutex mtx; // Mutex for thread safety
+    TimerWait waiter; // Where the scheduler thread sleeps: condition variable or timerfd
+    // When the sleeping scheduler thread wakes up by itself; min() while it is awake
+    std::chrono::time_point<std::chrono::steady_clock> wakeAt = std::chrono::time_point<std::chrono::steady_clock>::min();
+    bool stopScheduler = false; // Flag to stop the scheduler
+    std::unique_ptr<WorkStealingPool> pool; // Workers for due tasks; null when tasks run inline
+    std::thread schedulerThread; // Scheduler thread
+
+    // Scheduler thread function
+    void run() {
+        bool woke = false; // Last iteration ended in a timed wait
+        while (true) {
+            std::unique_lock<std::mutex> lock(mtx);
+
+            // Wait until there is a task or the scheduler is stopped
+            while (taskQueue.empty() && !stopScheduler) {
+                waitUntil(lock, std::chrono::time_point<std::chrono::steady_clock>::max());
+            }
+
+            if (stopScheduler && taskQueue.empty()) {
+                break; // Exit the thread if the scheduler is stopped
+            }
+
+            auto now = std::chrono::steady_clock::now();
+            auto deadline = taskQueue.nextTime();
+            auto due = deadline - taskQueue.task(taskQueue.nextId()).slack;
+            Timers::TimerId id;
+
+            // The earliest deadline's task runs once it is due, even if its deadline is still ahead
+            if (due <= now && taskQueue.detachDue(deadline, id)) {
+                woke = false;
+                Metrics::record(Metrics::Lateness, now - due);
+                Metrics::record(Metrics::QueueDepth, taskQueue.size() + 1);
+
+                // Execute the task, or hand it to the pool so the timer thread never waits on it
+                Task& task = taskQueue.task(id);
+                if (task.period == std::chrono::steady_clock::duration::zero()) {
+                    InplaceTask<> func = std::move(task.func);
+                    taskQueue.cancel(id); // Frees the slot
+                    lock.unlock(); // Unlock before executing the task
+                    if (pool) {
+                        pool->submit(std::move(func));
+                    } else {
+                        Metrics::ScopedTimer timer(Metrics::Execution);
+                        func();
+                    }
+                } else {
+                    // Periodic: the task stays in its slot and is re-armed in place after the run
+                    task.due = due;
+                    Task* periodic = &task;
+                    lock.unlock();
+                    if (pool) {
+                        pool->submit([this, periodic]() { runPeriodic(*periodic); }); // Small enough to be stored inline
+                    } else {
+                        runPeriodic(task);
+                    }
+                }
+            } else {
+                if (woke) {
+                    Metrics::count(Metrics::SpuriousWakeups); // Woke up, but nothing was due
+                }
+                // Wait until the earliest deadline; every task due by then runs in this wakeup
+                waitUntil(lock, deadline);
+                Metrics::count(Metrics::Wakeups);
+                woke = true;
+            }
+        }
+    }
+
+    // Scheduler thread: sleep until `until` or until a task that is due earlier arrives
+    void waitUntil(std::unique_lock<std::mutex>& lock, std::chrono::time_point<std::chrono::steady_clock> until) {
+        wakeAt = until;
+        waiter.waitUntil(lock, until);
+        wakeAt = std::chrono::time_point<std::chrono::steady_clock>::min();
+    }
+
+    // Under mtx: whether a task with this deadline has to wake the scheduler thread
+    bool mustWake(std::chrono::time_point<std::chrono::steady_clock> deadline) const {
+        return deadline < wakeAt;
+    }
+
+    // Runs a detached periodic task, then puts it back into the heap at its next due time.
+    // Only one run of a periodic task is ever in flight, so runs never overlap.
+    void runPeriodic(Task& task) {
+        {
+            Metrics::ScopedTimer timer(Metrics::Execution);
+            task.func();
+        }
+        bool wake;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (task.cancelled || stopScheduler) {
+                taskQueue.cancel(task.id);
+                return;
+            }
+            auto now = std::chrono::steady_clock::now();
+            auto next = task.due + task.period;
+            if (task.mode == Recurrence::FixedDelay) {
+                next = now + task.period;
+            } else if (task.mode == Recurrence::FixedRateSkip && next <= now) {
+                next += task.period * ((now - next) / task.period + 1);
+            }
+            taskQueue.rearm(task.id, next + task.slack);
+            wake = mustWake(next + task.slack);
+        }
+        if (wake) {
+            waiter.notify();
+        }
+    }
+
+public:
+    // Returned by schedule(); cancels or moves the task while it is still pending.
+    // Must not outlive the scheduler. A default-constructed handle refers to nothing.
+    class TimerHandle {
+    public:
+        TimerHandle() = default;
+
+        // Returns false if the task already ran (or started running) or was cancelled.
+        // A periodic task cancelled while running finishes that run and is not re-armed.
+        bool cancel() {
+            if (!scheduler) return false;
+            std::lock_guard<std::mutex> lock(scheduler->mtx);
+            Timers& timers = scheduler->taskQueue;
+            if (timers.pending(id)) {
+                return timers.cancel(id);
+            }
+            if (!timers.contains(id) || timers.task(id).cancelled) {
+                return false;
+            }
+            timers.task(id).cancelled = true;
+            return true;
+        }
+
+        bool reschedule(std::chrono::time_point<std::chrono::steady_clock> time) {
+            if (!scheduler) return false;
+            bool wake;
+            {
+                std::lock_guard<std::mutex> lock(scheduler->mtx);
+                Timers& timers = scheduler->taskQueue;
+                if (!timers.pending(id)) return false;
+                auto deadline = time + timers.task(id).slack;
+                timers.reschedule(id, deadline);
+                wake = scheduler->mustWake(deadline);
+            }
+            if (wake) {
+                scheduler->waiter.notify(); // The task is now due earlier than the scheduler is waiting for
+            }
+            return true;
+        }
+
+        bool rescheduleAfter(int delayMs) {
+            return reschedule(std::chrono::steady_clock::now() + std::chrono::milliseconds(delayMs));
+        }
+
+    private:
+        friend class AtomicTaskScheduler;
+        TimerHandle(AtomicTaskScheduler* scheduler, Timers::TimerId id) : scheduler(scheduler), id(id) {}
+
+        AtomicTaskScheduler* scheduler = nullptr;
+        Timers::TimerId id;
+    };
+
+    // workerCount == 0: tasks run one at a time on the scheduler thread.
+    // workerCount > 0: the scheduler thread only dispatches; tasks run on a work-stealing pool.
+    // waitMode: how the scheduler thread sleeps (TimerWait.h).
+    explicit AtomicTaskScheduler(std::size_t workerCount = 0, WaitMode waitMode = WaitMode::ConditionVariable)
+        : waiter(waitMode) {
+        if (workerCount > 0) {
+            pool = std::make_unique<WorkStealingPool>(workerCount);
+        }
+        // Start the scheduler thread
+        schedulerThread = std::thread([this]() { run(); });
+    }
+
+    ~AtomicTaskScheduler() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopScheduler = true;
+            // Periodic tasks never run out; one-shot tasks still run before the scheduler exits
+            taskQueue.cancelIf([](const Task& task) { return task.period != std::chrono::steady_clock::duration::zero(); });
+        }
+        waiter.notify(); // Wake the scheduler thread to stop
+        if (schedulerThread.joinable()) {
+            schedulerThread.join(); // Wait for the scheduler thread to finish
+        }
+        pool.reset(); // Let the workers finish every task already handed over
+    }
+
+    // Per-worker counters in worker pool mode; empty when tasks run inline
+    std::vector<WorkStealingPool::WorkerStats> workerStats() const {
+        return pool ? pool->stats() : std::vector<WorkStealingPool::WorkerStats>{};
+    }
+
+    // Schedule a task to run at a specific time, or up to `slack` later if that saves a wakeup
+    TimerHandle schedule(InplaceTask<> func, std::chrono::time_point<std::chrono::steady_clock> time,
+                         std::chrono::steady_clock::duration slack = std::chrono::steady_clock::duration::zero()) {
+        Timers::TimerId id;
+        bool wake;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            id = taskQueue.add(time + slack, Task{std::move(func)});
+            taskQueue.task(id).slack = slack;
+            wake = mustWake(time + slack);
+        }
+        if (wake) {
+            waiter.notify(); // Notify the scheduler thread
+        }
+        return TimerHandle(this, id);
+    }
+
+    // Schedule a task to run every `period`, first one period from now. The task is stored once and
+    // re-armed in place after each run, so a tick allocates nothing and never copies the function.
+    // Each run may start up to `slack` after its due time; the grid itself does not move.
+    TimerHandle schedulePeriodic(InplaceTask<> func, std::chrono::steady_clock::duration period,
+                                 Recurrence mode = Recurrence::FixedRate,
+                                 std::chrono::steady_clock::duration slack = std::chrono::steady_clock::duration::zero()) {
+        Timers::TimerId id;
+        bool wake;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            auto deadline = std::chrono::steady_clock::now() + period + slack;
+            id = taskQueue.add(deadline, Task{std::move(func), period, mode});
+            taskQueue.task(id).id = id;
+            taskQueue.task(id).slack = slack;
+            wake = mustWake(deadline);
+        }
+        if (wake) {
+            waiter.notify();
+        }
+        return TimerHandle(this, id);
+    }
+
+    // Schedule a task to run after a delay (in milliseconds), with up to slackMs of slack
+    TimerHandle scheduleAfter(InplaceTask<> func, int delayMs, int slackMs = 0) {
+        auto executeAt = std::chrono::steady_clock::now() + std::chrono::milliseconds(delayMs);
+        return schedule(std::move(func), executeAt, std::chrono::milliseconds(slackMs));
+    }
+
+    // co_await in a coroutine: resume it through `executor` at `time`; no thread waits meanwhile
+    SleepAwaiter<AtomicTaskScheduler> sleepUntil(std::chrono::time_point<std::chrono::steady_clock> time,
+                                                 Executor executor = {}) {
+        return SleepAwaiter<AtomicTaskScheduler>(*this, time, executor);
+    }
+
+    SleepAwaiter<AtomicTaskScheduler> sleepFor(std::chrono::steady_clock::duration delay, Executor executor = {}) {
+        return sleepUntil(std::chrono::steady_clock::now() + delay, executor);
+    }
+};
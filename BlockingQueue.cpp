@@ -1,104 +1,1179 @@
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
 #include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
 #include <mutex>
+#include <new>
 #include <thread>
 #include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#if defined(__linux__)
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
 
 
 
+/*
+RingBuffer: growable circular buffer usable as the storage of std::queue (and so of BlockingQueue).
+
+std::deque, the default, allocates and frees a chunk every few elements as the queue slides through
+memory. RingBuffer only allocates when it has to grow, doubling its capacity, and never shrinks, so
+once it has reached the high-water mark of the traffic, pushes and pops do no heap allocation at all.
+Elements are constructed in place and moved out, so move-only types such as std::unique_ptr work.
+*/
 template <typename T>
+class RingBuffer
+{
+	T* slots = nullptr;
+	std::size_t capacity_ = 0;	// always zero or a power of two
+	std::size_t head = 0;		// index of the front element
+	std::size_t count = 0;
+
+	T* at(std::size_t i) const
+	{
+		return slots + ((head + i) & (capacity_ - 1));
+	}
+
+	static T* allocate(std::size_t n)
+	{
+		return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(alignof(T))));
+	}
+
+	static void deallocate(T* p)
+	{
+		::operator delete(p, std::align_val_t(alignof(T)));
+	}
+
+	void grow(std::size_t atLeast)
+	{
+		std::size_t bigger = capacity_ ? capacity_ : 16;
+		while (bigger < atLeast)
+			bigger <<= 1;
+		if (bigger == capacity_)
+			return;
+
+		T* fresh = allocate(bigger);
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			new (fresh + i) T(std::move(*at(i)));
+			at(i)->~T();
+		}
+		deallocate(slots);
+		slots = fresh;
+		capacity_ = bigger;
+		head = 0;
+	}
+
+	void release()
+	{
+		while (count > 0)
+			pop_front();
+		deallocate(slots);
+		slots = nullptr;
+		capacity_ = 0;
+		head = 0;
+	}
+
+public:
+	using value_type = T;
+	using reference = T&;
+	using const_reference = const T&;
+	using size_type = std::size_t;
+
+	RingBuffer() {}
+
+	// Preallocate room for `capacity` elements so even the warm-up does not allocate
+	explicit RingBuffer(std::size_t capacity)
+	{
+		grow(capacity);
+	}
+
+	RingBuffer(RingBuffer&& other) noexcept
+		: slots(std::exchange(other.slots, nullptr)), capacity_(std::exchange(other.capacity_, 0)),
+		head(std::exchange(other.head, 0)), count(std::exchange(other.count, 0))
+	{
+	}
+
+	RingBuffer& operator= (RingBuffer&& other) noexcept
+	{
+		if (this != &other)
+		{
+			release();
+			slots = std::exchange(other.slots, nullptr);
+			capacity_ = std::exchange(other.capacity_, 0);
+			head = std::exchange(other.head, 0);
+			count = std::exchange(other.count, 0);
+		}
+		return *this;
+	}
+
+	RingBuffer(const RingBuffer&) = delete;
+	RingBuffer& operator= (const RingBuffer&) = delete;
+
+	~RingBuffer()
+	{
+		release();
+	}
+
+	template <typename... Args>
+	T& emplace_back(Args&&... args)
+	{
+		if (count == capacity_)
+			grow(count + 1);
+		T* slot = at(count);
+		new (slot) T(std::forward<Args>(args)...);
+		++count;
+		return *slot;
+	}
+
+	void push_back(const T& t) { emplace_back(t); }
+	void push_back(T&& t) { emplace_back(std::move(t)); }
+
+	void pop_front()
+	{
+		at(0)->~T();
+		head = (head + 1) & (capacity_ - 1);
+		--count;
+	}
+
+	T& front() { return *at(0); }
+	const T& front() const { return *at(0); }
+	T& back() { return *at(count - 1); }
+	const T& back() const { return *at(count - 1); }
+
+	std::size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+	std::size_t capacity() const { return capacity_; }
+
+	void swap(RingBuffer& other) noexcept
+	{
+		std::swap(slots, other.slots);
+		std::swap(capacity_, other.capacity_);
+		std::swap(head, other.head);
+		std::swap(count, other.count);
+	}
+};
+
+
+/*
+Container is the storage behind the queue: std::deque by default, or RingBuffer<T> for
+allocation-free steady state (see above).
+
+Bounded mode: BlockingQueue<T> q(capacity) holds at most capacity elements. Producers then get
+backpressure instead of growing the queue until the process runs out of memory: enQueue/emplace
+block while the queue is full, tryEnQueue fails at once and tryEnQueueFor gives up after a timeout.
+Consumers have the same three forms (deQueue, tryDeQueue, tryDeQueueFor). A capacity of 0 (the
+default) means unbounded.
+
+Producers and consumers wait on separate condition variables (notFull, notEmpty), and every wait
+is counted, so a push wakes one waiting consumer with notify_one, a pop wakes one waiting producer,
+and nobody is notified when nobody waits. A slot freed while producers are blocked is handed over
+to the one it wakes: a producer arriving in the meantime finds the queue still full and waits
+behind the blocked ones instead of taking the slot. enQueueBulk and the bulk pops wake as many waiters as
+elements (or free slots) they moved, not all of them.
+
+close() ends the queue: it wakes every waiter, producers fail from then on (enQueue returns false),
+and consumers take what is left and then fail too (deQueue() throws BlockingQueueClosed, the other
+pops return false or 0). A pollable queue stays readable once closed, so a poller wakes up and can
+check isClosed().
+
+Pollable mode (Linux): pollFd() returns an eventfd that is readable while the queue may hold
+elements, so a thread can wait for the queue in epoll/poll next to its sockets instead of parking a
+helper thread in deQueue() for every queue. The eventfd is written only when the queue goes from
+empty to non-empty, and reset by whichever pop empties the queue, so a steady stream of messages
+costs one write per burst, not one per message. After readiness, drain with tryDeQueueBatch (or
+deQueueBulk) until it returns fewer than max elements: with edge-triggered epoll there is no new
+event for elements left behind. A readiness event can be spurious (a consumer emptied the queue
+between the write and the wakeup); the drain then just returns 0. Until pollFd() is first called the
+queue costs nothing extra.
+*/
+struct BlockingQueueClosed : std::runtime_error
+{
+	BlockingQueueClosed() : std::runtime_error("BlockingQueue is closed") {}
+};
+
+template <typename T, typename Container = std::deque<T>>
 class BlockingQueue
 {
-	std::queue<T> Q;
+	using Deadline = std::chrono::steady_clock::time_point;	// min(): do not wait, max(): wait as long as it takes
+
+	std::queue<T, Container> Q;
 	std::mutex mutex;
-	std::condition_variable cv;
+	std::condition_variable notEmpty;	// Consumers wait here
+	std::condition_variable notFull;	// Producers wait here (bounded mode)
+	std::size_t waitingConsumers = 0;
+	std::size_t waitingProducers = 0;
+	std::size_t handedOver = 0;	// Free slots promised to woken producers; newcomers do not see them
+	std::size_t bound = 0;	// Capacity; 0 means unbounded
+	bool closed = false;
+	int readyFd = -1;	// eventfd of pollable mode; set once under the lock, closed by the destructor
+
+	// Caller holds the lock. Slots handed over to woken producers count as taken.
+	bool full() const
+	{
+		return bound != 0 && Q.size() + handedOver >= bound;
+	}
+
+	// Caller holds the lock. Waits on cv, counted in waiters, until ready() or the deadline;
+	// returns ready().
+	template <typename Ready>
+	static bool waitUntil(std::condition_variable& cv, std::size_t& waiters, std::unique_lock<std::mutex>& lock,
+		Ready ready, Deadline deadline)
+	{
+		if (ready() || deadline == Deadline::min())
+			return ready();
+		++waiters;
+		bool ok = true;
+		if (deadline == Deadline::max())
+			cv.wait(lock, ready);
+		else
+			ok = cv.wait_until(lock, deadline, ready);
+		--waiters;
+		return ok;
+	}
+
+	static Deadline deadlineAfter(std::chrono::steady_clock::duration timeout)
+	{
+		return std::chrono::steady_clock::now() + timeout;
+	}
+
+	// Caller holds the lock. Waits until the deadline at most for room for one element: a free slot,
+	// or one a pop handed over to this producer. Returns false if the queue is closed or still full.
+	bool waitForRoom(std::unique_lock<std::mutex>& lock, Deadline deadline)
+	{
+		if (closed || !full())
+			return !closed;
+		if (deadline == Deadline::min())
+			return false;
+		bool ready = waitUntil(notFull, waitingProducers, lock, [this]() { return handedOver > 0 || !full() || closed; }, deadline);
+		if (handedOver > 0)
+			--handedOver;	// Ours, or one meant for a producer still asleep that now finds the queue full again
+		return ready && !closed;
+	}
+
+	// Push what push() adds (one element) once there is room, waiting until the deadline at most.
+	// Returns false if the queue is closed or still full.
+	template <typename Push>
+	bool pushWhenRoom(Push push, Deadline deadline)
+	{
+		int fd;
+		bool wake;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			if (!waitForRoom(lock, deadline))
+				return false;
+			fd = readyFdIfEmpty();
+			push();
+			wake = waitingConsumers > 0;
+		}
+
+		signalReady(fd);
+		if (wake)
+			notEmpty.notify_one();
+		return true;
+	}
+
+	// Move the front element into out once there is one, waiting until the deadline at most.
+	// Returns false if the queue is (still) empty, i.e. timed out or closed and drained.
+	bool popWhenReady(T& out, Deadline deadline)
+	{
+		std::size_t wake;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			if (!waitUntil(notEmpty, waitingConsumers, lock, [this]() { return !Q.empty() || closed; }, deadline) || Q.empty())
+				return false;
+			out = std::move(Q.front());
+			Q.pop();
+			resetIfEmpty();
+			wake = producersToWake(1);
+		}
+
+		wakeProducers(wake);
+		return true;
+	}
+
+	// Caller holds the lock
+	template <typename OutputIt>
+	std::size_t popBulk(OutputIt& out, std::size_t max)
+	{
+		std::size_t count = 0;
+		while (count < max && !Q.empty())
+		{
+			*out = std::move(Q.front());
+			++out;
+			Q.pop();
+			++count;
+		}
+		if (count > 0)
+			resetIfEmpty();
+		return count;
+	}
+
+	// Caller holds the lock, `freed` elements were just popped: how many waiting producers to wake.
+	// Each freed slot goes to a blocked producer that has not been woken yet, and is handed over
+	// to it (handedOver) so a producer arriving in the meantime cannot take it first.
+	std::size_t producersToWake(std::size_t freed)
+	{
+		std::size_t wake = std::min(freed, waitingProducers - handedOver);
+		handedOver += wake;
+		return wake;
+	}
+
+	// Caller has released the lock
+	void wakeProducers(std::size_t count)
+	{
+		for (; count > 0; --count)
+			notFull.notify_one();
+	}
+
+	// Caller holds the lock. Resetting under the lock orders it before the next empty -> non-empty push.
+	// A closed queue stays readable.
+	void resetIfEmpty()
+	{
+#if defined(__linux__)
+		if (readyFd >= 0 && Q.empty() && !closed)
+		{
+			uint64_t count;
+			while (read(readyFd, &count, sizeof count) > 0)
+				;
+		}
+#endif
+	}
+
+	// Caller has released the lock; fd is readyFd as read under it
+	static void signalReady(int fd)
+	{
+#if defined(__linux__)
+		if (fd >= 0)
+		{
+			uint64_t one = 1;
+			ssize_t written = write(fd, &one, sizeof one);
+			(void)written;	// EAGAIN: the counter is already non-zero, the fd is readable anyway
+		}
+#else
+		(void)fd;
+#endif
+	}
+
+	// Caller holds the lock and is about to push: the fd to signal once the lock is released, or -1
+	int readyFdIfEmpty() const
+	{
+		return Q.empty() ? readyFd : -1;
+	}
 public:
 	BlockingQueue() {}
-	BlockingQueue(BlockingQueue<T>&& other)
-	{
-		std::lock_guard lock(mutex);
 
-		Q = other.Q;
-		while (other.Q.size() > 0)
-			other.Q.clear();
+	// Bounded mode: hold at most capacity elements (0: unbounded)
+	explicit BlockingQueue(std::size_t capacity) : bound(capacity) {}
+
+	// Start from existing storage, e.g. BlockingQueue<T, RingBuffer<T>> q{ RingBuffer<T>(4096) };
+	explicit BlockingQueue(Container storage, std::size_t capacity = 0) : Q(std::move(storage)), bound(capacity) {}
+
+	BlockingQueue(BlockingQueue&& other)
+	{
+		std::lock_guard lock(other.mutex);
+		Q = std::move(other.Q);
+		bound = other.bound;
+		closed = other.closed;
+		other.resetIfEmpty();
 	}
 
-	BlockingQueue<T>& operator= (BlockingQueue<T>&& other)
+	BlockingQueue& operator= (BlockingQueue&& other)
 	{
 		if (this == &other)
 			return *this;
 
+		std::scoped_lock lock(mutex, other.mutex);
+		Q = std::move(other.Q);
+		bound = other.bound;
+		closed = other.closed;
+		other.resetIfEmpty();
+		resetIfEmpty();
+		if (!Q.empty() || closed)
+			signalReady(readyFd);
+		notEmpty.notify_all();
+		notFull.notify_all();
+
+		return *this;
+	}
+
+	BlockingQueue(const BlockingQueue&) = delete;
+	BlockingQueue& operator= (const BlockingQueue&) = delete;
+
+	~BlockingQueue()
+	{
+#if defined(__linux__)
+		if (readyFd >= 0)
+			::close(readyFd);
+#endif
+	}
+
+#if defined(__linux__)
+	// Switch on pollable mode (see above) and return its eventfd; the queue owns it.
+	// Returns -1 with errno set if the eventfd cannot be created.
+	int pollFd()
+	{
 		std::lock_guard lock(mutex);
-		Q = other.Q;
+		if (readyFd < 0)
+		{
+			readyFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+			if (readyFd >= 0 && (!Q.empty() || closed))
+				signalReady(readyFd);
+		}
+		return readyFd;
+	}
+#endif
 
-		while (other.Q.size() > 0)
-			other.Q.pop();
+	// Stop accepting elements and wake every waiter (see above). Closing twice does nothing.
+	void close()
+	{
+		int fd;
+		{
+			std::lock_guard lock(mutex);
+			if (closed)
+				return;
+			closed = true;
+			fd = readyFd;
+		}
 
-		return *this;
+		signalReady(fd);
+		notEmpty.notify_all();
+		notFull.notify_all();
 	}
 
-	BlockingQueue(const BlockingQueue<T>&) = delete;
-	BlockingQueue<T>& operator= (const BlockingQueue<T>&) = delete;
+	bool isClosed()
+	{
+		std::lock_guard lock(mutex);
+		return closed;
+	}
 
+	// Blocks until an element is available and moves it out.
+	// Throws BlockingQueueClosed once the queue is closed and empty.
 	T deQueue()
 	{
+		std::size_t wake;
 		std::unique_lock lock(mutex);
+		waitUntil(notEmpty, waitingConsumers, lock, [this]() { return !Q.empty() || closed; }, Deadline::max());
+		if (Q.empty())
+			throw BlockingQueueClosed();
+
+		T temp = std::move(Q.front());
+		Q.pop();
+		resetIfEmpty();
+		wake = producersToWake(1);
+		lock.unlock();
+		wakeProducers(wake);
+		return temp;
+	}
+
+	// Blocks until an element is available and moves it into out; false once closed and empty
+	bool deQueue(T& out)
+	{
+		return popWhenReady(out, Deadline::max());
+	}
+
+	// Moves an element into out if there is one, without blocking
+	bool tryDeQueue(T& out)
+	{
+		return popWhenReady(out, Deadline::min());
+	}
 
-		if (!Q.empty())
+	// Like deQueue(out), but gives up after timeout
+	template <typename Rep, typename Period>
+	bool tryDeQueueFor(T& out, const std::chrono::duration<Rep, Period>& timeout)
+	{
+		return popWhenReady(out, deadlineAfter(std::chrono::duration_cast<std::chrono::steady_clock::duration>(timeout)));
+	}
+
+	// Blocks while the queue is full; returns false (and drops t) if the queue is closed
+	bool enQueue(const T& t)
+	{
+		return pushWhenRoom([&]() { Q.push(t); }, Deadline::max());
+	}
+
+	bool enQueue(T&& t)
+	{
+		return pushWhenRoom([&]() { Q.push(std::move(t)); }, Deadline::max());
+	}
+
+	// Adds t only if there is room right now; t is left untouched when this returns false
+	bool tryEnQueue(T&& t)
+	{
+		return pushWhenRoom([&]() { Q.push(std::move(t)); }, Deadline::min());
+	}
+
+	bool tryEnQueue(const T& t)
+	{
+		return pushWhenRoom([&]() { Q.push(t); }, Deadline::min());
+	}
+
+	// Like enQueue, but gives up after timeout; t is left untouched when this returns false
+	template <typename Rep, typename Period>
+	bool tryEnQueueFor(T&& t, const std::chrono::duration<Rep, Period>& timeout)
+	{
+		return pushWhenRoom([&]() { Q.push(std::move(t)); },
+			deadlineAfter(std::chrono::duration_cast<std::chrono::steady_clock::duration>(timeout)));
+	}
+
+	template <typename Rep, typename Period>
+	bool tryEnQueueFor(const T& t, const std::chrono::duration<Rep, Period>& timeout)
+	{
+		return pushWhenRoom([&]() { Q.push(t); },
+			deadlineAfter(std::chrono::duration_cast<std::chrono::steady_clock::duration>(timeout)));
+	}
+
+	// Construct the element in place from args; blocks while the queue is full, false if closed
+	template <typename... Args>
+	bool emplace(Args&&... args)
+	{
+		return pushWhenRoom([&]() { Q.emplace(std::forward<Args>(args)...); }, Deadline::max());
+	}
+
+	// Push [first, last), moving from the range, under one lock per stretch of free room; waiters
+	// are woken once per stretch. In bounded mode blocks while the queue is full. Returns how many
+	// elements were pushed: fewer than the range only if the queue was closed.
+	template <typename InputIt>
+	std::size_t enQueueBulk(InputIt first, InputIt last)
+	{
+		std::size_t total = 0;
+		while (first != last)
 		{
-			T temp = Q.front();
-			Q.pop();
-			return temp;
+			std::size_t count = 0;
+			std::size_t wake;
+			bool wakeAll;
+			int fd;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				if (!waitForRoom(lock, Deadline::max()))
+					return total;
+				fd = readyFdIfEmpty();
+				do
+				{
+					Q.push(std::move(*first));
+					++first;
+					++count;
+				} while (first != last && !full());
+				wake = std::min(count, waitingConsumers);
+				wakeAll = wake > 1 && wake == waitingConsumers;
+			}
+
+			signalReady(fd);
+			if (wakeAll)
+				notEmpty.notify_all();	// At least as many elements as waiters: every waiter gets one
+			else
+				for (; wake > 0; --wake)
+					notEmpty.notify_one();
+			total += count;
 		}
+		return total;
+	}
 
-		while (Q.empty())
+	// Pop up to max elements into out under one lock without blocking; returns how many were popped
+	template <typename OutputIt>
+	std::size_t deQueueBulk(OutputIt out, std::size_t max)
+	{
+		std::size_t count;
+		std::size_t wake;
 		{
-			cv.wait(lock, [this]() {return (!Q.empty()); });
+			std::lock_guard lock(mutex);
+			count = popBulk(out, max);
+			wake = producersToWake(count);
+		}
+		wakeProducers(wake);
+		return count;
+	}
 
-			T temp = Q.front();
-			Q.pop();
+	// Replace the contents of batch with up to max elements, without blocking; batch keeps its
+	// capacity, so a consumer reusing one vector does not allocate. Returns batch.size().
+	std::size_t tryDeQueueBatch(std::vector<T>& batch, std::size_t max)
+	{
+		batch.clear();
+		return deQueueBulk(std::back_inserter(batch), max);
+	}
+
+	// Like deQueueBulk, but first blocks until at least one element is available.
+	// Returns 0 once the queue is closed and empty.
+	template <typename OutputIt>
+	std::size_t drainTo(OutputIt out, std::size_t max)
+	{
+		if (max == 0)
+			return 0;
 
-			return temp;
+		std::size_t count;
+		std::size_t wake;
+		{
+			std::unique_lock lock(mutex);
+			waitUntil(notEmpty, waitingConsumers, lock, [this]() { return !Q.empty() || closed; }, Deadline::max());
+			count = popBulk(out, max);
+			wake = producersToWake(count);
 		}
+		wakeProducers(wake);
+		return count;
 	}
 
-	void enQueue(const T& t)
+	// Blocks until an element is available and returns a copy of it, leaving it in the queue.
+	// A reference would dangle as soon as the lock is released and another thread pops.
+	// Throws BlockingQueueClosed once the queue is closed and empty.
+	T front()
+	{
+		std::unique_lock lock(mutex);
+		waitUntil(notEmpty, waitingConsumers, lock, [this]() { return !Q.empty() || closed; }, Deadline::max());
+		if (Q.empty())
+			throw BlockingQueueClosed();
+		return Q.front();
+	}
+
+	void clear()
 	{
+		bool wake;
 		{
-			std::unique_lock<std::mutex> lock(mutex);
-			Q.push(t);
+			std::lock_guard lock(mutex);
+
+			while (!Q.empty())
+				Q.pop();
+			resetIfEmpty();
+			wake = waitingProducers > 0;
 		}
+		if (wake)
+			notFull.notify_all();
+	}
 
-		cv.notify_all();
+	size_t size()
+	{
+		std::lock_guard lock(mutex);
+		return Q.size();
 	}
 
-	T& front()
+	// The bound of bounded mode; 0 when unbounded
+	std::size_t capacity()
 	{
 		std::lock_guard lock(mutex);
+		return bound;
+	}
+};
+
+
+
+/*
+LockFreeBlockingQueue: bounded multi-producer / multi-consumer variant of BlockingQueue.
+
+The queue is a power-of-two ring of slots (Dmitry Vyukov's bounded MPMC queue). Every slot carries a
+sequence number telling whether it is ready to be written (sequence == position) or read
+(sequence == position + 1). A producer claims a position with one CAS on tail, writes the value and
+publishes it by bumping the slot's sequence; consumers do the same on head. head and tail live on
+separate cache lines, so producers and consumers do not invalidate each other's line on every operation.
+
+enQueue/deQueue keep the blocking interface of BlockingQueue: a consumer facing an empty queue (or a
+producer facing a full one) spins briefly, then parks with std::atomic::wait (a futex on Linux).
+The other side only issues a wake-up when somebody is actually parked.
+*/
+template <typename T>
+class LockFreeBlockingQueue
+{
+	static constexpr std::size_t cacheLine = 64;
+	static constexpr int spinLimit = 128;
+
+	struct Slot
+	{
+		std::atomic<std::size_t> sequence;
+		T value;
+	};
+
+	alignas(cacheLine) std::atomic<std::size_t> head{ 0 };	// next position to dequeue
+	alignas(cacheLine) std::atomic<std::size_t> tail{ 0 };	// next position to enqueue
+	alignas(cacheLine) std::atomic<uint32_t> notEmpty{ 0 };	// bumped to wake parked consumers
+	std::atomic<uint32_t> sleepingConsumers{ 0 };
+	alignas(cacheLine) std::atomic<uint32_t> notFull{ 0 };	// bumped to wake parked producers
+	std::atomic<uint32_t> sleepingProducers{ 0 };
+	alignas(cacheLine) const std::size_t mask;
+	std::unique_ptr<Slot[]> slots;
+
+	static void cpuRelax()
+	{
+#if defined(__x86_64__) || defined(__i386__)
+		__builtin_ia32_pause();
+#else
+		std::this_thread::yield();
+#endif
+	}
+
+	static std::size_t roundUp(std::size_t capacity)
+	{
+		std::size_t size = 2;
+		while (size < capacity)
+			size <<= 1;
+		return size;
+	}
+
+	static void wake(std::atomic<uint32_t>& epoch, std::atomic<uint32_t>& sleepers)
+	{
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (sleepers.load(std::memory_order_relaxed) > 0)
+		{
+			epoch.fetch_add(1, std::memory_order_release);
+			epoch.notify_one();
+		}
+	}
+
+	// Spin on `attempt`, then park on `epoch` until the other side bumps it
+	template <typename Attempt>
+	static void waitFor(Attempt attempt, std::atomic<uint32_t>& epoch, std::atomic<uint32_t>& sleepers)
+	{
+		for (int spin = 0; spin < spinLimit; ++spin)
+		{
+			if (attempt())
+				return;
+			cpuRelax();
+		}
+
+		while (true)
+		{
+			uint32_t seen = epoch.load(std::memory_order_acquire);
+			sleepers.fetch_add(1, std::memory_order_seq_cst);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			bool done = attempt();
+			if (!done)
+				epoch.wait(seen, std::memory_order_acquire);
+			sleepers.fetch_sub(1, std::memory_order_relaxed);
+			if (done || attempt())
+				return;
+		}
+	}
+
+	template <typename U>
+	bool push(U&& t)
+	{
+		std::size_t pos = tail.load(std::memory_order_relaxed);
+		while (true)
+		{
+			Slot& slot = slots[pos & mask];
+			std::size_t seq = slot.sequence.load(std::memory_order_acquire);
+			intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+			if (diff == 0)
+			{
+				if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					slot.value = std::forward<U>(t);
+					slot.sequence.store(pos + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (diff < 0)
+			{
+				return false;	// full
+			}
+			else
+			{
+				pos = tail.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+public:
+	explicit LockFreeBlockingQueue(std::size_t capacity = 1024)
+		: mask(roundUp(capacity) - 1), slots(new Slot[mask + 1])
+	{
+		for (std::size_t i = 0; i <= mask; ++i)
+			slots[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	LockFreeBlockingQueue(const LockFreeBlockingQueue<T>&) = delete;
+	LockFreeBlockingQueue<T>& operator= (const LockFreeBlockingQueue<T>&) = delete;
+
+	bool tryEnQueue(const T& t)
+	{
+		if (!push(t))
+			return false;
+		wake(notEmpty, sleepingConsumers);
+		return true;
+	}
+
+	bool tryDeQueue(T& out)
+	{
+		std::size_t pos = head.load(std::memory_order_relaxed);
+		while (true)
+		{
+			Slot& slot = slots[pos & mask];
+			std::size_t seq = slot.sequence.load(std::memory_order_acquire);
+			intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+			if (diff == 0)
+			{
+				if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					out = std::move(slot.value);
+					slot.sequence.store(pos + mask + 1, std::memory_order_release);
+					wake(notFull, sleepingProducers);
+					return true;
+				}
+			}
+			else if (diff < 0)
+			{
+				return false;	// empty
+			}
+			else
+			{
+				pos = head.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	// Blocks while the queue is full
+	void enQueue(const T& t)
+	{
+		waitFor([&]() { return push(t); }, notFull, sleepingProducers);
+		wake(notEmpty, sleepingConsumers);
+	}
+
+	// Blocks while the queue is empty
+	T deQueue()
+	{
 		T temp;
+		waitFor([&]() { return tryDeQueue(temp); }, notEmpty, sleepingConsumers);
+		return temp;
+	}
+
+	std::size_t capacity() const
+	{
+		return mask + 1;
+	}
+
+	// Approximate while other threads are operating on the queue
+	std::size_t size() const
+	{
+		std::size_t t = tail.load(std::memory_order_acquire);
+		std::size_t h = head.load(std::memory_order_acquire);
+		return t >= h ? t - h : 0;
+	}
+};
+
+
+
+/*
+MpscMailbox: unbounded multi-producer / single-consumer queue, for actors fed by many threads.
+
+The queue is a linked list of fixed-size segments of SegmentSize slots. tail packs the current
+segment's address with the number of slots claimed in it (segments are aligned so that the low bits
+of the address are free), so a producer claims a slot with a single fetch_add on tail, which tells
+it both the segment and the index. It constructs the element there and publishes it by setting the
+slot's ready flag. The producer that claims the first index past the end allocates the next
+segment, links it and points tail at it; producers that overflowed meanwhile wait for that and
+claim again. Up to 3 * SegmentSize - 1 producers may wait on a full segment at once; more would
+carry into the address bits.
+
+The consumer owns head: it reads ready flags with plain loads, moves elements out and walks into
+the next segment once a segment is used up, with no atomic read-modify-write at all. deQueueBulk
+and drainTo take everything that is ready, segment after segment, in one call. Used-up segments
+go back to a free list (a few atomic spare pointers that linking producers take with one exchange,
+backed by a short list owned by the consumer), so in steady state the queue does not allocate.
+
+A consumer facing an empty queue spins briefly, then parks with std::atomic::wait; a producer only
+issues a wake-up when the consumer is actually parked. Only one thread may call the consumer-side
+functions (tryDeQueue, deQueue, deQueueBulk, tryDeQueueBatch, drainTo, empty).
+*/
+template <typename T, std::size_t SegmentSize = 256>
+class MpscMailbox
+{
+	static_assert(SegmentSize >= 2 && SegmentSize <= 4096, "SegmentSize must be in [2, 4096]");
+
+	static constexpr std::size_t cacheLine = 64;
+	static constexpr std::size_t segmentAlign = std::max<std::size_t>(cacheLine, std::bit_ceil(SegmentSize) * 4);
+	static constexpr uintptr_t indexMask = segmentAlign - 1;
+	static constexpr int spinLimit = 128;
+	static constexpr std::size_t spareCount = 8;
+	static constexpr std::size_t freeListLimit = 64;	// segments the consumer keeps beyond the spares
 
-		if (!Q.empty())
+	struct Slot
+	{
+		std::atomic<bool> ready{ false };
+		alignas(T) unsigned char storage[sizeof(T)];
+
+		T* value()
 		{
-			temp = Q.front();
+			return std::launder(reinterpret_cast<T*>(storage));
 		}
+	};
+
+	struct alignas(segmentAlign) Segment
+	{
+		Slot slots[SegmentSize];
+		std::atomic<Segment*> next{ nullptr };
+	};
+
+	alignas(cacheLine) std::atomic<uintptr_t> tail;	// current segment | slots claimed in it
+	alignas(cacheLine) std::atomic<Segment*> spares[spareCount] = {};
+	alignas(cacheLine) std::atomic<uint32_t> notEmpty{ 0 };	// bumped to wake the parked consumer
+	std::atomic<bool> sleeping{ false };
+	alignas(cacheLine) Segment* head;	// consumer only from here on
+	std::size_t headIndex = 0;
+	std::vector<Segment*> freeList;
+
+	static void cpuRelax()
+	{
+#if defined(__x86_64__) || defined(__i386__)
+		__builtin_ia32_pause();
+#else
+		std::this_thread::yield();
+#endif
+	}
+
+	// Spin first, then yield: the thread being waited for may be preempted
+	static void backoff(int& spin)
+	{
+		if (++spin < spinLimit)
+			cpuRelax();
 		else
+			std::this_thread::yield();
+	}
+
+	static Segment* segmentOf(uintptr_t claim)
+	{
+		return reinterpret_cast<Segment*>(claim & ~indexMask);
+	}
+
+	Segment* takeSegment()
+	{
+		for (auto& spare : spares)
 		{
-			cv.wait(lock, [this]() {return (!Q.empty()); });
-			temp = Q.front();
+			if (spare.load(std::memory_order_relaxed) != nullptr)
+			{
+				if (Segment* segment = spare.exchange(nullptr, std::memory_order_acquire))
+					return segment;
+			}
 		}
+		return new Segment;
+	}
 
+	template <typename... Args>
+	static void publish(Slot& slot, Args&&... args)
+	{
+		new (slot.storage) T(std::forward<Args>(args)...);
+		slot.ready.store(true, std::memory_order_release);
+	}
+
+	void wakeConsumer()
+	{
+		// The fetch_add on tail and this load are both seq_cst, pairing with the fence in waitForClaim
+		if (sleeping.load(std::memory_order_seq_cst) && sleeping.exchange(false, std::memory_order_relaxed))
+		{
+			notEmpty.fetch_add(1, std::memory_order_release);
+			notEmpty.notify_one();
+		}
+	}
+
+	// Consumer: the slot at head if its element is published, moving on to the next segment
+	// when the current one is used up
+	Slot* readySlot()
+	{
+		if (headIndex == SegmentSize)
+		{
+			Segment* next = head->next.load(std::memory_order_acquire);
+			if (next == nullptr)
+				return nullptr;
+			recycle(head);
+			head = next;
+			headIndex = 0;
+		}
+		Slot& slot = head->slots[headIndex];
+		return slot.ready.load(std::memory_order_acquire) ? &slot : nullptr;
+	}
+
+	T take(Slot& slot)
+	{
+		T* value = slot.value();
+		T temp(std::move(*value));
+		value->~T();
+		slot.ready.store(false, std::memory_order_relaxed);	// the segment is clean when it is recycled
+		++headIndex;
 		return temp;
 	}
-	void clear()
+
+	// Consumer: a used-up segment goes to the consumer's list, which tops up the empty spares
+	void recycle(Segment* segment)
 	{
-		std::lock_guard lock(mutex);
+		segment->next.store(nullptr, std::memory_order_relaxed);
+		if (freeList.size() < freeListLimit)
+			freeList.push_back(segment);
+		else
+			delete segment;
+		for (auto& spare : spares)
+		{
+			if (freeList.empty())
+				break;
+			if (spare.load(std::memory_order_relaxed) == nullptr)
+			{
+				// Only the consumer stores non-null spares, so the slot stays empty until this store
+				spare.store(freeList.back(), std::memory_order_release);
+				freeList.pop_back();
+			}
+		}
+	}
 
-		while (!Q.empty())
-			Q.pop();
+	// Consumer: whether a producer has claimed the slot at head, published or not
+	bool claimed() const
+	{
+		return tail.load(std::memory_order_seq_cst) != (reinterpret_cast<uintptr_t>(head) | headIndex);
 	}
 
-	size_t size()
+	// Consumer: block until the slot at head is claimed, then until it is published
+	Slot* waitForSlot()
 	{
-		std::lock_guard lock(mutex);
-		return Q.size();
+		for (int spin = 0; spin < spinLimit && !claimed(); ++spin)
+			cpuRelax();
+
+		while (!claimed())
+		{
+			uint32_t seen = notEmpty.load(std::memory_order_acquire);
+			sleeping.store(true, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (!claimed())
+				notEmpty.wait(seen, std::memory_order_acquire);
+			sleeping.store(false, std::memory_order_relaxed);
+		}
+
+		// The producer is between its fetch_add and publishing (or linking the next segment)
+		Slot* slot;
+		for (int spin = 0; (slot = readySlot()) == nullptr;)
+			backoff(spin);
+		return slot;
+	}
+
+public:
+	MpscMailbox() : tail(0), head(new Segment)
+	{
+		tail.store(reinterpret_cast<uintptr_t>(head), std::memory_order_relaxed);
+		freeList.reserve(freeListLimit);
+	}
+
+	MpscMailbox(const MpscMailbox&) = delete;
+	MpscMailbox& operator= (const MpscMailbox&) = delete;
+
+	// No thread may be using the queue any more
+	~MpscMailbox()
+	{
+		Segment* segment = head;
+		std::size_t index = headIndex;
+		while (segment != nullptr)
+		{
+			for (; index < SegmentSize; ++index)
+			{
+				if (segment->slots[index].ready.load(std::memory_order_acquire))
+					segment->slots[index].value()->~T();
+			}
+			Segment* next = segment->next.load(std::memory_order_acquire);
+			delete segment;
+			segment = next;
+			index = 0;
+		}
+		for (auto& spare : spares)
+			delete spare.load(std::memory_order_relaxed);
+		for (Segment* free : freeList)
+			delete free;
+	}
+
+	// Never blocks, except while another producer links the next segment
+	template <typename... Args>
+	void emplace(Args&&... args)
+	{
+		while (true)
+		{
+			uintptr_t claim = tail.fetch_add(1, std::memory_order_seq_cst);
+			Segment* segment = segmentOf(claim);
+			std::size_t index = claim & indexMask;
+			if (index < SegmentSize)
+			{
+				publish(segment->slots[index], std::forward<Args>(args)...);
+				break;
+			}
+			if (index == SegmentSize)
+			{
+				// First claim past the end: take the first slot of the next segment, move tail there,
+				// and only then link it. A consumer can reach slot 0 only through the link, so by
+				// the time it has taken it tail has moved on, and claimed() is false again.
+				Segment* next = takeSegment();
+				publish(next->slots[0], std::forward<Args>(args)...);
+				tail.store(reinterpret_cast<uintptr_t>(next) | 1, std::memory_order_seq_cst);
+				segment->next.store(next, std::memory_order_release);
+				break;
+			}
+			for (int spin = 0; segmentOf(tail.load(std::memory_order_acquire)) == segment;)
+				backoff(spin);
+		}
+		wakeConsumer();
+	}
+
+	void enQueue(const T& t)
+	{
+		emplace(t);
+	}
+
+	void enQueue(T&& t)
+	{
+		emplace(std::move(t));
+	}
+
+	bool tryDeQueue(T& out)
+	{
+		Slot* slot = readySlot();
+		if (slot == nullptr)
+			return false;
+		out = take(*slot);
+		return true;
+	}
+
+	// Blocks while the queue is empty
+	T deQueue()
+	{
+		Slot* slot = readySlot();
+		if (slot == nullptr)
+			slot = waitForSlot();
+		return take(*slot);
+	}
+
+	// Pop up to max published elements into out without blocking; returns how many were popped
+	template <typename OutputIt>
+	std::size_t deQueueBulk(OutputIt out, std::size_t max)
+	{
+		std::size_t count = 0;
+		while (count < max)
+		{
+			Slot* slot = readySlot();
+			if (slot == nullptr)
+				break;
+			*out++ = take(*slot);
+			++count;
+		}
+		return count;
+	}
+
+	// Replace the contents of batch with up to max elements, without blocking. Returns batch.size().
+	std::size_t tryDeQueueBatch(std::vector<T>& batch, std::size_t max)
+	{
+		batch.clear();
+		return deQueueBulk(std::back_inserter(batch), max);
+	}
+
+	// Like deQueueBulk, but first blocks until at least one element is available
+	template <typename OutputIt>
+	std::size_t drainTo(OutputIt out, std::size_t max)
+	{
+		if (max == 0)
+			return 0;
+		if (readySlot() == nullptr)
+			waitForSlot();
+		return deQueueBulk(out, max);
+	}
+
+	// Consumer only; an element that is claimed but not yet published counts
+	bool empty() const
+	{
+		return !claimed();
 	}
 };
@@ -0,0 +1,100 @@
+/*
+Heap allocations per message through BlockingQueue
+
+One producer and one consumer exchange messages through BlockingQueue; after a warm-up the benchmark
+counts global operator new calls (AllocationCounter.h) and reports them per message:
+•	uint64_t over the default std::deque storage.
+•	uint64_t over RingBuffer storage.
+•	std::unique_ptr to a 4KB buffer over RingBuffer storage. Buffers are never copied: they travel to
+	the consumer and back to the producer through a second queue, so the payloads are recycled too.
+
+Usage: BlockingQueueAllocBenchmark [messages]   (default 1000000)
+---
+Output (numbers vary by storage, not by machine):
+storage                 allocs/msg
+deque<uint64_t>         0.0156
+...
+*/
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include "AllocationCounter.h"
+#include "BlockingQueue.cpp"
+
+namespace {
+
+constexpr std::size_t warmUp = 10000;
+
+using Buffer = std::array<char, 4096>;
+
+// Allocations per message over `messages` messages sent after the warm-up
+template <typename Queue>
+double countValues(Queue& queue, std::size_t messages)
+{
+	uint64_t before = 0;
+	std::thread consumer([&queue, messages]() {
+		for (std::size_t i = 0; i < warmUp + messages; ++i)
+			queue.deQueue();
+	});
+	for (std::size_t i = 0; i < warmUp + messages; ++i)
+	{
+		if (i == warmUp)
+			before = allocationCount();
+		queue.enQueue(i);
+	}
+	consumer.join();
+	return static_cast<double>(allocationCount() - before) / static_cast<double>(messages);
+}
+
+double countBuffers(std::size_t messages)
+{
+	using Queue = BlockingQueue<std::unique_ptr<Buffer>, RingBuffer<std::unique_ptr<Buffer>>>;
+	constexpr std::size_t inFlight = 64;
+	Queue full{ RingBuffer<std::unique_ptr<Buffer>>(inFlight) };
+	Queue empty{ RingBuffer<std::unique_ptr<Buffer>>(inFlight) };
+	for (std::size_t i = 0; i < inFlight; ++i)
+		empty.emplace(std::make_unique<Buffer>());
+
+	uint64_t before = 0;
+	std::thread consumer([&full, &empty, messages]() {
+		for (std::size_t i = 0; i < warmUp + messages; ++i)
+		{
+			std::unique_ptr<Buffer> buffer = full.deQueue();
+			(*buffer)[0] = 0;
+			empty.enQueue(std::move(buffer));
+		}
+	});
+	for (std::size_t i = 0; i < warmUp + messages; ++i)
+	{
+		if (i == warmUp)
+			before = allocationCount();
+		std::unique_ptr<Buffer> buffer = empty.deQueue();
+		(*buffer)[0] = static_cast<char>(i);
+		full.enQueue(std::move(buffer));
+	}
+	consumer.join();
+	return static_cast<double>(allocationCount() - before) / static_cast<double>(messages);
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+	std::size_t messages = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+
+	std::printf("%-32s %10s\n", "storage", "allocs/msg");
+	{
+		BlockingQueue<uint64_t> queue;
+		std::printf("%-32s %10.4f\n", "deque<uint64_t>", countValues(queue, messages));
+	}
+	{
+		BlockingQueue<uint64_t, RingBuffer<uint64_t>> queue;
+		std::printf("%-32s %10.4f\n", "RingBuffer<uint64_t>", countValues(queue, messages));
+	}
+	std::printf("%-32s %10.4f\n", "RingBuffer<unique_ptr<Buffer>>", countBuffers(messages));
+	return 0;
+}
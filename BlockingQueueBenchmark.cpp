@@ -0,0 +1,171 @@
+/*
+BlockingQueue vs LockFreeBlockingQueue
+
+P producer threads each push messages stamped with the steady_clock time of the push; C consumer
+threads pop them and record the push-to-pop latency. Every configuration runs against:
+•	mutex: BlockingQueue, one element per enQueue/deQueue.
+•	batch: BlockingQueue, enQueueBulk/drainTo with up to 64 elements per lock acquisition.
+•	lockfree: LockFreeBlockingQueue (capacity 4096).
+All three live in BlockingQueue.cpp.
+
+Usage: BlockingQueueBenchmark [messages] [threads ...]
+	messages: total messages per run (default 400000)
+	threads:  producer = consumer counts to try (default 1 4 16)
+---
+Output (numbers vary by machine):
+queue      P   C     Mmsg/s    p50 ns    p99 ns   p99.9 ns
+mutex      1   1   ...
+lockfree   1   1   ...
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BlockingQueue.cpp"
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+uint64_t nowNs()
+{
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count());
+}
+
+struct Result
+{
+	double messagesPerSec;
+	uint64_t p50;
+	uint64_t p99;
+	uint64_t p999;
+};
+
+Result summarize(const std::vector<std::vector<uint64_t>>& latencies, Clock::duration elapsed)
+{
+	std::vector<uint64_t> all;
+	for (auto& l : latencies)
+		all.insert(all.end(), l.begin(), l.end());
+	std::sort(all.begin(), all.end());
+	auto pct = [&all](double q) { return all[std::min(all.size() - 1, static_cast<std::size_t>(q * static_cast<double>(all.size())))]; };
+	double seconds = std::chrono::duration<double>(elapsed).count();
+	return { static_cast<double>(all.size()) / seconds, pct(0.50), pct(0.99), pct(0.999) };
+}
+
+// Pushes perProducer * producers messages through `queue`; a stamp of 0 is never produced
+template <typename Queue>
+Result run(Queue& queue, int producers, int consumers, std::size_t perProducer)
+{
+	std::size_t total = perProducer * static_cast<std::size_t>(producers);
+	std::size_t perConsumer = total / static_cast<std::size_t>(consumers);
+	std::vector<std::vector<uint64_t>> latencies(static_cast<std::size_t>(consumers));
+	std::vector<std::thread> threads;
+
+	auto start = Clock::now();
+	for (int c = 0; c < consumers; ++c)
+	{
+		threads.emplace_back([&queue, &latencies, c, perConsumer]() {
+			auto& mine = latencies[static_cast<std::size_t>(c)];
+			mine.reserve(perConsumer);
+			for (std::size_t i = 0; i < perConsumer; ++i)
+			{
+				uint64_t stamp = queue.deQueue();
+				mine.push_back(nowNs() - stamp);
+			}
+		});
+	}
+	for (int p = 0; p < producers; ++p)
+	{
+		threads.emplace_back([&queue, perProducer]() {
+			for (std::size_t i = 0; i < perProducer; ++i)
+				queue.enQueue(nowNs());
+		});
+	}
+	for (auto& t : threads)
+		t.join();
+	return summarize(latencies, Clock::now() - start);
+}
+
+// Same traffic as run(), moved in batches of up to `batch` elements per lock acquisition
+Result runBatched(BlockingQueue<uint64_t>& queue, int producers, int consumers, std::size_t perProducer, std::size_t batch)
+{
+	std::size_t total = perProducer * static_cast<std::size_t>(producers);
+	std::size_t perConsumer = total / static_cast<std::size_t>(consumers);
+	std::vector<std::vector<uint64_t>> latencies(static_cast<std::size_t>(consumers));
+	std::vector<std::thread> threads;
+
+	auto start = Clock::now();
+	for (int c = 0; c < consumers; ++c)
+	{
+		threads.emplace_back([&queue, &latencies, c, perConsumer, batch]() {
+			auto& mine = latencies[static_cast<std::size_t>(c)];
+			mine.reserve(perConsumer);
+			std::vector<uint64_t> stamps(batch);
+			while (mine.size() < perConsumer)
+			{
+				std::size_t n = queue.drainTo(stamps.begin(), std::min(batch, perConsumer - mine.size()));
+				uint64_t now = nowNs();
+				for (std::size_t i = 0; i < n; ++i)
+					mine.push_back(now - stamps[i]);
+			}
+		});
+	}
+	for (int p = 0; p < producers; ++p)
+	{
+		threads.emplace_back([&queue, perProducer, batch]() {
+			std::vector<uint64_t> stamps;
+			for (std::size_t sent = 0; sent < perProducer; sent += stamps.size())
+			{
+				stamps.assign(std::min(batch, perProducer - sent), 0);
+				uint64_t now = nowNs();
+				for (auto& stamp : stamps)
+					stamp = now;
+				queue.enQueueBulk(stamps.begin(), stamps.end());
+			}
+		});
+	}
+	for (auto& t : threads)
+		t.join();
+	return summarize(latencies, Clock::now() - start);
+}
+
+void print(const char* name, int producers, int consumers, const Result& r)
+{
+	std::printf("%-10s %3d %3d %10.2f %9llu %9llu %10llu\n", name, producers, consumers, r.messagesPerSec / 1e6,
+		static_cast<unsigned long long>(r.p50), static_cast<unsigned long long>(r.p99), static_cast<unsigned long long>(r.p999));
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+	std::size_t messages = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 400000;
+	std::vector<int> threadCounts;
+	for (int i = 2; i < argc; ++i)
+		threadCounts.push_back(std::atoi(argv[i]));
+	if (threadCounts.empty())
+		threadCounts = { 1, 4, 16 };
+
+	std::printf("%-10s %3s %3s %10s %9s %9s %10s\n", "queue", "P", "C", "Mmsg/s", "p50 ns", "p99 ns", "p99.9 ns");
+	for (int n : threadCounts)
+	{
+		std::size_t perProducer = messages / static_cast<std::size_t>(n);
+		{
+			BlockingQueue<uint64_t> queue;
+			print("mutex", n, n, run(queue, n, n, perProducer));
+		}
+		{
+			BlockingQueue<uint64_t> queue;
+			print("batch", n, n, runBatched(queue, n, n, perProducer, 64));
+		}
+		{
+			LockFreeBlockingQueue<uint64_t> queue(4096);
+			print("lockfree", n, n, run(queue, n, n, perProducer));
+		}
+	}
+	return 0;
+}
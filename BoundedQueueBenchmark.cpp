@@ -0,0 +1,168 @@
+/*
+BlockingQueue under overload (unbounded vs bounded) and wakeups per message
+
+•	overload: P producers push N 64-byte messages as fast as they can into one queue; a single
+	consumer spends about 1us on each. Unbounded, the queue absorbs the whole backlog; bounded
+	(capacity C), producers block in enQueue and the queue never holds more than C messages.
+	Reports the peak queue length, the growth of the resident set and the throughput.
+•	herd: K consumers block in deQueue on an empty queue; one thread pushes M messages one at a
+	time, each acknowledged through a second queue before the next. Reports context switches per
+	message (voluntary + involuntary, whole process, from getrusage). A push wakes one consumer;
+	with notify_all it woke all K, and all but one went back to sleep.
+
+Usage: BoundedQueueBenchmark [messages] [producers] [capacity] [consumers]
+	(default: 1000000 4 1024 16)
+---
+Output on a single-core machine (numbers vary by machine):
+overload    capacity   peak len  RSS growth MB       Mmsg/s
+bounded         1024       1024            0.6         0.29
+unbounded          0     968255           62.6         0.77
+consumers    messages   switches/message
+16              20000               2.32
+With the earlier notify_all wakeups the herd row was 17.01 switches per message. The bounded row
+pays for strict blocking on one core: every slot the consumer frees goes straight to a blocked
+producer, so each message costs a producer wakeup (0.82 Mmsg/s when producers were only woken
+after the queue had drained to half, which let late producers overtake blocked ones).
+*/
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BlockingQueue.cpp"
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct Message
+{
+	uint64_t sequence = 0;
+	char payload[56] = {};
+};
+
+long rssKb()
+{
+	std::ifstream status("/proc/self/status");
+	std::string line;
+	while (std::getline(status, line))
+	{
+		if (line.rfind("VmRSS:", 0) == 0)
+			return std::atol(line.c_str() + 6);
+	}
+	return -1;
+}
+
+long contextSwitches()
+{
+	rusage usage{};
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_nvcsw + usage.ru_nivcsw;
+}
+
+void spinFor(std::chrono::nanoseconds work)
+{
+	auto until = Clock::now() + work;
+	while (Clock::now() < until)
+		;
+}
+
+void overload(const char* kind, std::size_t capacity, std::size_t messages, int producers)
+{
+	BlockingQueue<Message> queue(capacity);
+	std::atomic<std::size_t> peak{ 0 };
+	long rssBefore = rssKb();
+	long rssPeak = rssBefore;
+	auto start = Clock::now();
+
+	std::thread consumer([&]() {
+		Message message;
+		for (std::size_t received = 0; received < messages; ++received)
+		{
+			queue.deQueue(message);
+			spinFor(std::chrono::microseconds(1));
+			if ((received & 1023) == 0)
+				peak.store(std::max(peak.load(std::memory_order_relaxed), queue.size()), std::memory_order_relaxed);
+		}
+	});
+	std::vector<std::thread> threads;
+	for (int p = 0; p < producers; ++p)
+	{
+		threads.emplace_back([&, p]() {
+			std::size_t count = messages / static_cast<std::size_t>(producers) + (static_cast<std::size_t>(p) < messages % static_cast<std::size_t>(producers) ? 1 : 0);
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				Message message;
+				message.sequence = i;
+				queue.enQueue(std::move(message));
+			}
+		});
+	}
+	for (auto& t : threads)
+		t.join();
+	rssPeak = std::max(rssPeak, rssKb());	// Producers are done: the backlog is at its largest
+	consumer.join();
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	std::printf("%-10s %9zu %10zu %14.1f %12.2f\n", kind, capacity, peak.load(), static_cast<double>(rssPeak - rssBefore) / 1024.0,
+		static_cast<double>(messages) / seconds / 1e6);
+}
+
+void herd(int consumers, std::size_t messages)
+{
+	constexpr uint64_t stop = UINT64_MAX;
+	BlockingQueue<uint64_t> queue;
+	BlockingQueue<uint64_t> acks;
+	std::vector<std::thread> threads;
+	for (int c = 0; c < consumers; ++c)
+	{
+		threads.emplace_back([&]() {
+			while (true)
+			{
+				uint64_t value = queue.deQueue();
+				if (value == stop)
+					return;
+				acks.enQueue(value);
+			}
+		});
+	}
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));	// Let every consumer block
+
+	long before = contextSwitches();
+	for (uint64_t i = 0; i < messages; ++i)
+	{
+		queue.enQueue(i);
+		acks.deQueue();
+	}
+	long switches = contextSwitches() - before;
+	for (int c = 0; c < consumers; ++c)
+		queue.enQueue(stop);
+	for (auto& t : threads)
+		t.join();
+	std::printf("%-10d %10zu %18.2f\n", consumers, messages, static_cast<double>(switches) / static_cast<double>(messages));
+}
+
+}	// namespace
+
+int main(int argc, char* argv[])
+{
+	std::size_t messages = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+	int producers = argc > 2 ? std::atoi(argv[2]) : 4;
+	std::size_t capacity = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 1024;
+	int consumers = argc > 4 ? std::atoi(argv[4]) : 16;
+
+	std::printf("%-10s %9s %10s %14s %12s\n", "overload", "capacity", "peak len", "RSS growth MB", "Mmsg/s");
+	overload("bounded", capacity, messages, producers);	// First, so the unbounded run's heap does not hide its growth
+	overload("unbounded", 0, messages, producers);
+
+	std::printf("%-10s %10s %18s\n", "consumers", "messages", "switches/message");
+	herd(consumers, std::max<std::size_t>(messages / 50, 1));
+	return 0;
+}
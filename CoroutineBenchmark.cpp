@@ -0,0 +1,179 @@
+/*
+100k concurrent coroutine waiters on a handful of threads
+
+N coroutines (Coroutines.h) wait at the same time, each in one of the three ways, all served by one
+AtomicTaskScheduler in worker pool mode (W workers) plus one more WorkStealingPool used as an
+Executor:
+•	sleep: each coroutine sleeps three times until a random 50-500ms later. Reports how late the
+	resumptions were (vs their due time).
+•	acquire: each coroutine takes one token from a LockFreeRateLimiter at R tokens/s, starting with an
+	empty bucket, so nearly all of them have to wait. It does what AsyncRateLimiter::acquire() does
+	(reserve(), then sleep until the reserved time) by hand, to see the promised time. Reports the
+	achieved grant rate (should be R) and how late the grants were against that time.
+•	pop: N coroutines co_await pop() on an empty AsyncQueue, resumed on the pool Executor, then one
+	thread pushes N elements.
+Each row reports the peak thread count and the resident set size of the process while the
+coroutines are suspended.
+
+Usage: CoroutineBenchmark [coroutines] [workers] [tokens/s]   (default: 100000 4 200000)
+---
+Output on a single-core machine (numbers vary by machine):
+test      coroutines  threads   RSS MB   elapsed ms   result
+sleep         100000       10     33.3       1519.8   late mean 0.18 ms, max 2.47 ms
+acquire       100000       10     33.5        503.9   198474 grants/s, late mean 0.28 ms, max 9.20 ms
+pop           100000       10     34.3         45.9   every element delivered once
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include "AtomicTaskScheduler.h"
+#include "Coroutines.h"
+#include "LockFreeRateLimiter.h"
+#include "WorkStealingPool.h"
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+std::atomic<std::size_t> finished{0};
+std::atomic<int64_t> maxLateNs{0};
+std::atomic<int64_t> sumLateNs{0};
+std::atomic<uint64_t> lateSamples{0};
+
+// Reads "<field>: value" from /proc/self/status
+long procStatus(const char* field) {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    std::string prefix = std::string(field) + ":";
+    while (std::getline(status, line)) {
+        if (line.rfind(prefix, 0) == 0) return std::atol(line.c_str() + prefix.size());
+    }
+    return -1;
+}
+
+void recordLateness(Clock::time_point due) {
+    int64_t late = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - due).count();
+    sumLateNs.fetch_add(late, std::memory_order_relaxed);
+    lateSamples.fetch_add(1, std::memory_order_relaxed);
+    int64_t seen = maxLateNs.load(std::memory_order_relaxed);
+    while (late > seen && !maxLateNs.compare_exchange_weak(seen, late, std::memory_order_relaxed)) {
+    }
+}
+
+void resetLateness() {
+    maxLateNs = 0;
+    sumLateNs = 0;
+    lateSamples = 0;
+}
+
+Detached sleeper(AtomicTaskScheduler& scheduler, uint32_t seed) {
+    std::minstd_rand rng(seed);
+    for (int i = 0; i < 3; ++i) {
+        auto due = Clock::now() + std::chrono::milliseconds(50 + rng() % 450);
+        co_await scheduler.sleepUntil(due);
+        recordLateness(due);
+    }
+    finished.fetch_add(1, std::memory_order_relaxed);
+}
+
+Detached acquirer(LockFreeRateLimiter& limiter, AtomicTaskScheduler& scheduler) {
+    // What acquire() does, spelled out so the promised time can be compared with the resumption
+    auto due = limiter.reserve(1);
+    co_await scheduler.sleepUntil(due);
+    recordLateness(due);
+    finished.fetch_add(1, std::memory_order_relaxed);
+}
+
+Detached popper(AsyncQueue<uint64_t>& queue, std::atomic<uint64_t>& sum) {
+    uint64_t value = co_await queue.pop();
+    sum.fetch_add(value, std::memory_order_relaxed);
+    finished.fetch_add(1, std::memory_order_relaxed);
+}
+
+struct Sample {
+    long threads = 0;
+    long rssKb = 0;
+};
+
+// Wait for n coroutines to finish, sampling the process while they are suspended
+Sample waitFor(std::size_t n) {
+    Sample peak;
+    while (finished.load(std::memory_order_relaxed) < n) {
+        peak.threads = std::max(peak.threads, procStatus("Threads"));
+        peak.rssKb = std::max(peak.rssKb, procStatus("VmRSS"));
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return peak;
+}
+
+void print(const char* test, std::size_t n, const Sample& sample, Clock::time_point start, const char* result) {
+    std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+    std::printf("%-8s %11zu %8ld %8.1f %12.1f   %s\n", test, n, sample.threads, static_cast<double>(sample.rssKb) / 1024.0,
+                elapsed.count(), result);
+}
+
+std::string latenessSummary() {
+    uint64_t samples = std::max<uint64_t>(lateSamples.load(), 1);
+    char text[96];
+    std::snprintf(text, sizeof text, "late mean %.2f ms, max %.2f ms", static_cast<double>(sumLateNs.load()) / static_cast<double>(samples) / 1e6,
+                  static_cast<double>(maxLateNs.load()) / 1e6);
+    return text;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+    std::size_t workers = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 4;
+    double rate = argc > 3 ? std::strtod(argv[3], nullptr) : 200000.0;
+
+    AtomicTaskScheduler scheduler(std::max<std::size_t>(workers, 1));
+    WorkStealingPool pool(std::max<std::size_t>(workers, 1));
+    std::printf("%-8s %11s %8s %8s %12s   %s\n", "test", "coroutines", "threads", "RSS MB", "elapsed ms", "result");
+
+    {
+        finished = 0;
+        resetLateness();
+        auto start = Clock::now();
+        for (std::size_t i = 0; i < n; ++i) sleeper(scheduler, static_cast<uint32_t>(i + 1));
+        Sample sample = waitFor(n);
+        print("sleep", n, sample, start, latenessSummary().c_str());
+    }
+    {
+        finished = 0;
+        resetLateness();
+        LockFreeRateLimiter limiter(1, rate);
+        limiter.reserve(1); // Empty the bucket
+        auto start = Clock::now();
+        for (std::size_t i = 0; i < n; ++i) acquirer(limiter, scheduler);
+        Sample sample = waitFor(n);
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        char result[160];
+        std::snprintf(result, sizeof result, "%.0f grants/s, %s", static_cast<double>(n) / seconds, latenessSummary().c_str());
+        print("acquire", n, sample, start, result);
+    }
+    {
+        finished = 0;
+        AsyncQueue<uint64_t> queue{Executor(pool)};
+        std::atomic<uint64_t> sum{0};
+        auto start = Clock::now();
+        for (std::size_t i = 0; i < n; ++i) popper(queue, sum);
+        Sample suspended{procStatus("Threads"), procStatus("VmRSS")};
+        for (uint64_t i = 1; i <= n; ++i) queue.push(i);
+        Sample sample = waitFor(n);
+        sample.threads = std::max(sample.threads, suspended.threads);
+        sample.rssKb = std::max(sample.rssKb, suspended.rssKb);
+        bool ok = sum.load() == static_cast<uint64_t>(n) * (n + 1) / 2;
+        print("pop", n, sample, start, ok ? "every element delivered once" : "LOST ELEMENTS");
+        if (!ok) return 1;
+    }
+    return 0;
+}
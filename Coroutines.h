@@ -0,0 +1,191 @@
+#pragma once
+
+/*
+Coroutine awaitables: wait for a timer, a rate-limit token or a queue element without a thread
+
+A thread blocked in RateLimiter::acquire() or BlockingQueue::deQueue() is a thread per outstanding
+wait. A C++20 coroutine that co_awaits one of these instead is suspended: its frame (a few hundred
+bytes) stays on the heap and no thread waits for it, so 100k concurrent waits cost 100k frames, not
+100k stacks.
+•	co_await scheduler.sleepFor(d) / sleepUntil(t)   (AtomicTaskScheduler): the coroutine is put into
+	the scheduler's timer heap as an ordinary one-shot task that resumes it.
+•	co_await limiter.acquire(n)   (AsyncRateLimiter over a LockFreeRateLimiter): reserves n tokens
+	with one CAS, which yields the exact instant they become available, and sleeps until then. Tokens
+	are granted in reservation order; a coroutine that finds the bucket full is not suspended at all.
+•	co_await queue.pop()   (AsyncQueue): takes an element, or parks the coroutine on an intrusive
+	FIFO of waiters; push() hands its element straight to the longest waiting coroutine.
+
+Where a coroutine resumes is set by an Executor: by default it resumes on the thread that ended the
+wait (the scheduler thread or pool worker that runs due tasks, the thread calling push()); an
+Executor built from a WorkStealingPool (or anything with submit(InplaceTask<>)) resumes it there.
+Resuming inline is cheapest but runs the coroutine's next step on that thread, so keep it short or
+hand it to a pool.
+
+Detached is the return type for fire-and-forget coroutines: it starts running at the call and frees
+its frame when it finishes. A suspended coroutine must not be destroyed while a wait is pending, and
+nothing here cancels a wait; the scheduler, limiter and queue must outlive their waiters.
+*/
+
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include "LockFreeRateLimiter.h"
+
+// Where a suspended coroutine is resumed
+class Executor {
+public:
+    // Resume on the thread that ends the wait
+    Executor() = default;
+
+    // Resume on pool, through pool.submit(InplaceTask<>)
+    template <typename Pool>
+        requires(!std::is_same_v<Pool, Executor>) // Leave copying to the copy constructor
+    explicit Executor(Pool& pool)
+        : context_(&pool), post_([](void* p, std::coroutine_handle<> h) { static_cast<Pool*>(p)->submit([h] { h.resume(); }); }) {}
+
+    // Resume through post(context, handle), e.g. by posting to an event loop
+    Executor(void* context, void (*post)(void*, std::coroutine_handle<>)) : context_(context), post_(post) {}
+
+    void resume(std::coroutine_handle<> handle) const {
+        if (post_) {
+            post_(context_, handle);
+        } else {
+            handle.resume();
+        }
+    }
+
+private:
+    void* context_ = nullptr;
+    void (*post_)(void*, std::coroutine_handle<>) = nullptr;
+};
+
+// Return type of a fire-and-forget coroutine; an exception escaping it terminates the program
+struct Detached {
+    struct promise_type {
+        Detached get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+// Resumes the awaiting coroutine at `when` through a scheduler's schedule(InplaceTask<>, time_point)
+template <typename Timers>
+class SleepAwaiter {
+public:
+    SleepAwaiter(Timers& timers, std::chrono::steady_clock::time_point when, Executor executor)
+        : timers_(timers), when_(when), executor_(executor) {}
+
+    bool await_ready() const { return when_ <= std::chrono::steady_clock::now(); }
+
+    void await_suspend(std::coroutine_handle<> handle) {
+        // The coroutine may be resumed before schedule() even returns, so capture copies, not this
+        Executor executor = executor_;
+        timers_.schedule([handle, executor] { executor.resume(handle); }, when_);
+    }
+
+    void await_resume() const noexcept {}
+
+private:
+    Timers& timers_;
+    std::chrono::steady_clock::time_point when_;
+    Executor executor_;
+};
+
+// co_await-able front end of a LockFreeRateLimiter; Timers is the scheduler that wakes waiters
+template <typename Timers>
+class AsyncRateLimiter {
+public:
+    AsyncRateLimiter(LockFreeRateLimiter& limiter, Timers& timers, Executor executor = {})
+        : limiter_(limiter), timers_(timers), executor_(executor) {}
+
+    // Suspend until `tokens` tokens are available, then continue holding them
+    SleepAwaiter<Timers> acquire(uint64_t tokens = 1) {
+        return SleepAwaiter<Timers>(timers_, limiter_.reserve(tokens), executor_);
+    }
+
+private:
+    LockFreeRateLimiter& limiter_;
+    Timers& timers_;
+    Executor executor_;
+};
+
+// Unbounded MPMC queue whose pop() suspends the calling coroutine while the queue is empty
+template <typename T>
+class AsyncQueue {
+public:
+    class PopAwaiter {
+    public:
+        explicit PopAwaiter(AsyncQueue& queue) : queue_(queue) {}
+
+        bool await_ready() const noexcept { return false; }
+
+        // Take an element if there is one (and do not suspend); otherwise join the waiters
+        bool await_suspend(std::coroutine_handle<> handle) {
+            std::lock_guard<std::mutex> lock(queue_.mutex_);
+            if (!queue_.items_.empty()) {
+                value_.emplace(std::move(queue_.items_.front()));
+                queue_.items_.pop_front();
+                return false;
+            }
+            handle_ = handle;
+            if (queue_.tail_) {
+                queue_.tail_->next_ = this;
+            } else {
+                queue_.head_ = this;
+            }
+            queue_.tail_ = this;
+            return true;
+        }
+
+        T await_resume() { return std::move(*value_); }
+
+    private:
+        friend class AsyncQueue;
+        AsyncQueue& queue_;
+        std::optional<T> value_;
+        std::coroutine_handle<> handle_;
+        PopAwaiter* next_ = nullptr; // Intrusive FIFO of waiters; the awaiter lives in the coroutine frame
+    };
+
+    explicit AsyncQueue(Executor executor = {}) : executor_(executor) {}
+
+    AsyncQueue(const AsyncQueue&) = delete;
+    AsyncQueue& operator=(const AsyncQueue&) = delete;
+
+    // Hand value to the longest waiting coroutine and resume it, or store it
+    void push(T value) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        PopAwaiter* waiter = head_;
+        if (!waiter) {
+            items_.push_back(std::move(value));
+            return;
+        }
+        head_ = waiter->next_;
+        if (!head_) tail_ = nullptr;
+        waiter->value_.emplace(std::move(value));
+        lock.unlock();
+        executor_.resume(waiter->handle_);
+    }
+
+    PopAwaiter pop() { return PopAwaiter(*this); }
+
+    std::size_t size() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return items_.size();
+    }
+
+private:
+    Executor executor_;
+    std::mutex mutex_;
+    std::deque<T> items_;
+    PopAwaiter* head_ = nullptr;
+    PopAwaiter* tail_ = nullptr;
+};
@@ -0,0 +1,274 @@
+/*
+Loopback echo over EpollReactor
+
+The benchmark forks into two processes, one per side, so each side gets the full descriptor limit:
+•	Server (parent): one EpollReactor thread accepts connections and echoes whatever it reads. A
+	100ms housekeeping timer runs on the same loop, the way a service would expire idle connections.
+•	Client (child): opens C connections, then keeps one 16-byte request in flight on each (closed loop)
+	from its own EpollReactor. A request carries its send time; the round trip goes into a log-linear
+	histogram (Metrics::bucketIndex). After a warm-up second, requests are counted for S seconds; both
+	the warm-up and the end of the run are reactor timers.
+
+Reported: requests per second, round-trip percentiles, and per side the loop wakeups and idle wakeups
+(epoll_wait returned but nothing was ready or due). Idle wakeups should stay at zero: the timeout
+passed to epoll_wait always ends at a due timer.
+
+Usage: EpollEchoBenchmark [connections] [seconds]   (default: 10000 3)
+Needs 2 * connections descriptors across the two processes plus a few; the soft RLIMIT_NOFILE is
+raised to the hard limit.
+---
+Output on a single-core machine, client and server sharing the core (numbers vary by machine):
+connections  requests      req/s    p50 us    p99 us  p99.9 us
+10000          223744      74581  134217.7  188743.7  199311.8
+side      wakeups   idle wakeups   timers
+client       1182              0        2
+server       7798              0       41
+With one request in flight per connection, latency is connections / (req/s) by Little's law.
+*/
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "EpollReactor.h"
+#include "Metrics.h"
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+constexpr std::size_t kMessage = 16;
+
+[[noreturn]] void fail(const char* what) {
+    std::perror(what);
+    std::exit(1);
+}
+
+void raiseDescriptorLimit() {
+    rlimit limit{};
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+void printSide(const char* side, const EpollReactor::Stats& stats) {
+    std::printf("%-6s %10llu %14llu %8llu\n", side, static_cast<unsigned long long>(stats.wakeups),
+                static_cast<unsigned long long>(stats.idleWakeups), static_cast<unsigned long long>(stats.timersRun));
+}
+
+// Server side: echo everything back. Writes that would block are kept and flushed on EPOLLOUT.
+struct EchoConnection {
+    int fd;
+    std::vector<char> pending;
+
+    // Returns false once the peer is gone
+    bool onEvents() {
+        if (!flush()) return false;
+        char buffer[4096];
+        while (true) {
+            ssize_t n = read(fd, buffer, sizeof buffer);
+            if (n > 0) {
+                pending.insert(pending.end(), buffer, buffer + n);
+                if (!flush()) return false;
+            } else if (n == 0) {
+                return false;
+            } else {
+                return errno == EAGAIN || errno == EINTR;
+            }
+        }
+    }
+
+    bool flush() {
+        std::size_t sent = 0;
+        while (sent < pending.size()) {
+            ssize_t n = write(fd, pending.data() + sent, pending.size() - sent);
+            if (n < 0) {
+                if (errno == EAGAIN) break;
+                if (errno == EINTR) continue;
+                return false;
+            }
+            sent += static_cast<std::size_t>(n);
+        }
+        pending.erase(pending.begin(), pending.begin() + static_cast<std::ptrdiff_t>(sent));
+        return true;
+    }
+};
+
+void serve(int listener, pid_t client) {
+    EpollReactor reactor;
+    std::vector<std::unique_ptr<EchoConnection>> connections;
+
+    reactor.add(listener, EPOLLIN, [&](uint32_t) {
+        while (true) {
+            int fd = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (errno == EINTR) continue;
+                return; // EAGAIN: accepted everything that was queued
+            }
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+            if (static_cast<std::size_t>(fd) >= connections.size()) connections.resize(static_cast<std::size_t>(fd) + 1);
+            connections[fd] = std::make_unique<EchoConnection>(EchoConnection{fd, {}});
+            reactor.add(fd, EPOLLIN | EPOLLOUT | EPOLLRDHUP, [&, fd](uint32_t) {
+                if (!connections[fd]->onEvents()) {
+                    reactor.remove(fd);
+                    close(fd);
+                    connections[fd].reset();
+                }
+            });
+        }
+    });
+
+    // Housekeeping on the I/O thread; re-arms itself
+    uint64_t ticks = 0;
+    std::function<void()> housekeeping = [&] {
+        ++ticks;
+        reactor.runAfter(std::chrono::milliseconds(100), [&] { housekeeping(); });
+    };
+    reactor.runAfter(std::chrono::milliseconds(100), [&] { housekeeping(); });
+
+    std::thread loop([&] { reactor.run(); });
+    int status = 0;
+    waitpid(client, &status, 0);
+    reactor.stop();
+    loop.join();
+    printSide("server", reactor.stats());
+    for (auto& connection : connections) {
+        if (connection) close(connection->fd);
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        std::fprintf(stderr, "client failed\n");
+        std::exit(1);
+    }
+}
+
+// Client side: one request in flight per connection
+struct ClientConnection {
+    int fd;
+    char received[kMessage];
+    std::size_t have = 0;
+};
+
+int runClient(uint16_t port, std::size_t count, double seconds) {
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    EpollReactor reactor;
+    std::vector<ClientConnection> connections(count);
+    Metrics::HistogramSnapshot latency;
+    bool measuring = false;
+    bool done = false;
+
+    auto request = [](ClientConnection& c) {
+        char message[kMessage] = {};
+        int64_t now = Clock::now().time_since_epoch().count();
+        std::memcpy(message, &now, sizeof now);
+        if (write(c.fd, message, kMessage) != static_cast<ssize_t>(kMessage)) fail("write");
+    };
+
+    for (std::size_t i = 0; i < count; ++i) {
+        // Blocking connect, so a full accept backlog just makes us wait for the server
+        int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) fail("socket");
+        if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof address) < 0) fail("connect");
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        connections[i].fd = fd;
+        reactor.add(fd, EPOLLIN, [&, i](uint32_t) {
+            ClientConnection& c = connections[i];
+            while (true) {
+                ssize_t n = read(c.fd, c.received + c.have, kMessage - c.have);
+                if (n <= 0) {
+                    if (n < 0 && (errno == EAGAIN || errno == EINTR)) return;
+                    fail("read");
+                }
+                c.have += static_cast<std::size_t>(n);
+                if (c.have < kMessage) continue;
+                c.have = 0;
+                if (measuring) {
+                    int64_t sent;
+                    std::memcpy(&sent, c.received, sizeof sent);
+                    auto ns = static_cast<uint64_t>(Clock::now().time_since_epoch().count() - sent);
+                    ++latency.buckets[Metrics::bucketIndex(ns)];
+                    ++latency.count;
+                    latency.sum += ns;
+                    if (ns > latency.max) latency.max = ns;
+                }
+                if (!done) request(c);
+            }
+        });
+    }
+
+    auto warmup = std::chrono::seconds(1);
+    auto measured = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+    reactor.runAfter(warmup, [&] { measuring = true; });
+    reactor.runAfter(warmup + measured, [&] {
+        measuring = false;
+        done = true;
+        reactor.stop();
+    });
+    for (ClientConnection& c : connections) request(c);
+    reactor.run();
+
+    double us = 1e-3;
+    std::printf("%-11s %9s %10s %9s %9s %9s\n", "connections", "requests", "req/s", "p50 us", "p99 us", "p99.9 us");
+    std::printf("%-11zu %9llu %10.0f %9.1f %9.1f %9.1f\n", count, static_cast<unsigned long long>(latency.count),
+                static_cast<double>(latency.count) / seconds, static_cast<double>(latency.percentile(0.5)) * us,
+                static_cast<double>(latency.percentile(0.99)) * us, static_cast<double>(latency.percentile(0.999)) * us);
+    std::printf("%-6s %10s %14s %8s\n", "side", "wakeups", "idle wakeups", "timers");
+    printSide("client", reactor.stats());
+    std::fflush(stdout);
+    for (ClientConnection& c : connections) close(c.fd);
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000;
+    double seconds = argc > 2 ? std::strtod(argv[2], nullptr) : 3.0;
+    raiseDescriptorLimit();
+
+    int listener = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listener < 0) fail("socket");
+    int one = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof one);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof address;
+    if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof address) < 0 ||
+        listen(listener, SOMAXCONN) < 0 || getsockname(listener, reinterpret_cast<sockaddr*>(&address), &length) < 0) {
+        fail("listen");
+    }
+
+    std::fflush(stdout);
+    pid_t client = fork();
+    if (client < 0) fail("fork");
+    if (client == 0) {
+        close(listener);
+        std::exit(runClient(ntohs(address.sin_port), count, seconds));
+    }
+    serve(listener, client);
+    close(listener);
+    return 0;
+}
@@ -0,0 +1,245 @@
+#pragma once
+
+/*
+EpollReactor: edge-triggered epoll event loop with timers on the same thread (Linux)
+
+The C++ counterpart of the EventLoop in reactor_based.py: handlers are registered per file
+descriptor and called when it becomes ready. It differs in three ways:
+•	epoll, edge-triggered: the kernel keeps the interest list, so a wait costs O(ready fds) rather than
+	O(registered fds) as with select/poll. A handler is told about readiness once, so it must read
+	(or write) until EAGAIN; a handler stays registered until remove(), instead of being re-registered
+	after every event.
+•	Timers: runAt/runAfter put tasks in a TimerQueue (TimerQueue.h, the store AtomicTaskScheduler
+	uses). epoll_wait's timeout is the time to the earliest timer, rounded up to the next millisecond,
+	so the loop wakes up for I/O or for a due timer and never to poll: a wait that times out always
+	has a timer to run. No timerfd, no second thread.
+•	post() and stop() may be called from any thread; they wake the loop through an eventfd, which is
+	written only when the posted list goes from empty to non-empty.
+
+One loop iteration: epoll_wait, I/O handlers, due timers, posted tasks. stats() counts wakeups and
+idle wakeups (woke and found nothing to do); with metrics compiled in (Metrics.h) they are also
+counted as Wakeups / SpuriousWakeups, and timer lateness goes to Metrics::Lateness.
+
+Threading: everything except post() and stop() must be called on the thread running run() (or
+before run() starts). To add a timer or a descriptor from elsewhere, post() a task that does it.
+
+Handlers may add or remove descriptors, including their own; a removed handler is destroyed after the
+current batch of events. If a descriptor is closed and its number reused within one batch, the new
+handler can see a stale readiness event; with edge-triggered handlers that just means one read that
+returns EAGAIN.
+*/
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <utility>
+#include <vector>
+#include "InplaceTask.h"
+#include "Metrics.h"
+#include "TimerQueue.h"
+
+class EpollReactor {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Task = InplaceTask<>;
+    using Timers = TimerQueue<Task>;
+    using TimerId = Timers::TimerId;
+    // Called with the epoll event mask (EPOLLIN, EPOLLOUT, EPOLLRDHUP, EPOLLERR, ...)
+    using IoHandler = std::function<void(uint32_t events)>;
+
+    struct Stats {
+        uint64_t wakeups = 0;      // epoll_wait returns
+        uint64_t idleWakeups = 0;  // ... that found no I/O, no due timer and no posted task
+        uint64_t ioEvents = 0;     // Handler calls
+        uint64_t timersRun = 0;
+        uint64_t postedRun = 0;
+    };
+
+    static constexpr int kMaxEvents = 256;
+
+    EpollReactor() : epollFd_(epoll_create1(EPOLL_CLOEXEC)) {
+        if (epollFd_ < 0) {
+            throw std::system_error(errno, std::generic_category(), "epoll_create1");
+        }
+        wakeFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (wakeFd_ < 0) {
+            int error = errno;
+            close(epollFd_);
+            throw std::system_error(error, std::generic_category(), "eventfd");
+        }
+        control(EPOLL_CTL_ADD, wakeFd_, EPOLLIN);
+    }
+
+    ~EpollReactor() {
+        close(wakeFd_);
+        close(epollFd_);
+    }
+
+    EpollReactor(const EpollReactor&) = delete;
+    EpollReactor& operator=(const EpollReactor&) = delete;
+
+    // Watch fd for `events` (edge-triggered; EPOLLET is added). The reactor does not own fd.
+    void add(int fd, uint32_t events, IoHandler handler) {
+        if (static_cast<std::size_t>(fd) >= handlers_.size()) {
+            handlers_.resize(static_cast<std::size_t>(fd) + 1);
+        }
+        control(EPOLL_CTL_ADD, fd, events);
+        handlers_[fd] = std::make_unique<IoHandler>(std::move(handler));
+    }
+
+    void modify(int fd, uint32_t events) { control(EPOLL_CTL_MOD, fd, events); }
+
+    // Stop watching fd; call before closing it
+    void remove(int fd) {
+        if (static_cast<std::size_t>(fd) >= handlers_.size() || !handlers_[fd]) {
+            return;
+        }
+        control(EPOLL_CTL_DEL, fd, 0);
+        retired_.push_back(std::move(handlers_[fd])); // It may be the handler running right now
+    }
+
+    TimerId runAt(Clock::time_point when, Task task) { return timers_.add(when, std::move(task)); }
+
+    template <typename Rep, typename Period>
+    TimerId runAfter(std::chrono::duration<Rep, Period> delay, Task task) {
+        return runAt(Clock::now() + std::chrono::duration_cast<Clock::duration>(delay), std::move(task));
+    }
+
+    bool cancel(TimerId id) { return timers_.cancel(id); }
+
+    std::size_t pendingTimers() const { return timers_.size(); }
+
+    // Any thread: run task on the loop thread, after the current iteration's I/O and timers
+    void post(Task task) {
+        bool wasEmpty;
+        {
+            std::lock_guard<std::mutex> lock(postedMutex_);
+            wasEmpty = posted_.empty();
+            posted_.push_back(std::move(task));
+        }
+        if (wasEmpty) wake();
+    }
+
+    // Any thread: make run() return after the current iteration
+    void stop() {
+        stop_.store(true, std::memory_order_release);
+        wake();
+    }
+
+    void run() {
+        epoll_event events[kMaxEvents];
+        while (!stop_.load(std::memory_order_acquire)) {
+            int n = epoll_wait(epollFd_, events, kMaxEvents, timeoutMs());
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                throw std::system_error(errno, std::generic_category(), "epoll_wait");
+            }
+            ++stats_.wakeups;
+            Metrics::count(Metrics::Wakeups);
+
+            bool worked = false;
+            for (int i = 0; i < n; ++i) {
+                int fd = events[i].data.fd;
+                if (fd == wakeFd_) {
+                    uint64_t count;
+                    while (read(wakeFd_, &count, sizeof count) > 0) {
+                    }
+                    continue;
+                }
+                if (static_cast<std::size_t>(fd) < handlers_.size() && handlers_[fd]) {
+                    ++stats_.ioEvents;
+                    worked = true;
+                    (*handlers_[fd])(events[i].events);
+                }
+            }
+            retired_.clear();
+            worked |= runDueTimers();
+            worked |= runPosted();
+            if (!worked && !stop_.load(std::memory_order_relaxed)) {
+                ++stats_.idleWakeups;
+                Metrics::count(Metrics::SpuriousWakeups);
+            }
+        }
+        stop_.store(false, std::memory_order_relaxed);
+    }
+
+    // Loop thread, or after run() has returned
+    const Stats& stats() const { return stats_; }
+
+private:
+    int epollFd_;
+    int wakeFd_;
+    // Indexed by fd. Boxed, so remove() can retire a handler while it runs without moving it.
+    std::vector<std::unique_ptr<IoHandler>> handlers_;
+    std::vector<std::unique_ptr<IoHandler>> retired_; // Removed during the current batch
+    Timers timers_;
+    Stats stats_;
+
+    std::mutex postedMutex_;
+    std::vector<Task> posted_;
+    std::vector<Task> running_; // Swapped with posted_, so both keep their capacity
+    std::atomic<bool> stop_{false};
+
+    void control(int op, int fd, uint32_t events) {
+        epoll_event event{};
+        event.events = events | EPOLLET;
+        event.data.fd = fd;
+        if (epoll_ctl(epollFd_, op, fd, &event) < 0) {
+            throw std::system_error(errno, std::generic_category(), "epoll_ctl");
+        }
+    }
+
+    void wake() {
+        uint64_t one = 1;
+        ssize_t written = write(wakeFd_, &one, sizeof one);
+        (void)written; // EAGAIN means the counter is already non-zero: the loop is being woken anyway
+    }
+
+    // Time to the earliest timer, rounded up so the wait never ends before the timer is due
+    int timeoutMs() const {
+        if (timers_.empty()) return -1;
+        auto delay = timers_.nextTime() - Clock::now();
+        if (delay <= Clock::duration::zero()) return 0;
+        auto ms = std::chrono::ceil<std::chrono::milliseconds>(delay).count();
+        return ms < INT_MAX ? static_cast<int>(ms) : INT_MAX;
+    }
+
+    bool runDueTimers() {
+        auto now = Clock::now();
+        bool ran = false;
+        Task task;
+        while (!timers_.empty() && timers_.nextTime() <= now) {
+            Metrics::record(Metrics::Lateness, now - timers_.nextTime());
+            timers_.popDue(now, task);
+            ++stats_.timersRun;
+            ran = true;
+            task(); // May add or cancel timers
+            task.reset();
+        }
+        return ran;
+    }
+
+    bool runPosted() {
+        {
+            std::lock_guard<std::mutex> lock(postedMutex_);
+            if (posted_.empty()) return false;
+            std::swap(posted_, running_);
+        }
+        for (Task& task : running_) {
+            task();
+            ++stats_.postedRun;
+        }
+        running_.clear();
+        return true;
+    }
+};
@@ -0,0 +1,115 @@
+#pragma once
+
+/*
+InplaceTask: move-only void() callable with inline storage
+
+std::function has to be copyable and only keeps very small callables (16 bytes in libstdc++) inside
+the object; anything bigger, such as a lambda capturing a string and a couple of pointers, costs a heap
+allocation per task, and every copy of the task costs another one. The schedulers never need to copy
+a task, so InplaceTask drops copying altogether:
+•	Callables up to InlineSize bytes (and nothrow-movable) live inside the object: constructing,
+	moving and destroying the task never touches the heap.
+•	Larger callables still work; they are stored on the heap and moving the task just moves the pointer.
+	fitsInline<F> tells at compile time which path a callable takes.
+•	Callables only need to be movable, so a task may own a unique_ptr or another InplaceTask.
+
+sizeof(InplaceTask<InlineSize>) is InlineSize + one pointer, rounded up to 16; the default of 56 makes
+a task exactly one 64-byte cache line.
+*/
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+template <std::size_t InlineSize = 56>
+class InplaceTask {
+    static_assert(InlineSize >= sizeof(void*), "InlineSize must hold at least a pointer");
+
+public:
+    template <typename F>
+    static constexpr bool fitsInline = sizeof(F) <= InlineSize && alignof(F) <= alignof(std::max_align_t) &&
+                                       std::is_nothrow_move_constructible_v<F>;
+
+    InplaceTask() noexcept = default;
+    InplaceTask(std::nullptr_t) noexcept {}
+
+    template <typename F, typename Fn = std::decay_t<F>,
+              typename = std::enable_if_t<!std::is_same_v<Fn, InplaceTask> && std::is_invocable_r_v<void, Fn&>>>
+    InplaceTask(F&& f) {
+        if constexpr (fitsInline<Fn>) {
+            ::new (static_cast<void*>(storage_)) Fn(std::forward<F>(f));
+            ops_ = &inlineOps<Fn>;
+        } else {
+            ::new (static_cast<void*>(storage_)) Fn*(new Fn(std::forward<F>(f)));
+            ops_ = &heapOps<Fn>;
+        }
+    }
+
+    InplaceTask(InplaceTask&& other) noexcept { moveFrom(other); }
+
+    InplaceTask& operator=(InplaceTask&& other) noexcept {
+        if (this != &other) {
+            reset();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    InplaceTask& operator=(std::nullptr_t) noexcept {
+        reset();
+        return *this;
+    }
+
+    InplaceTask(const InplaceTask&) = delete;
+    InplaceTask& operator=(const InplaceTask&) = delete;
+
+    ~InplaceTask() { reset(); }
+
+    void operator()() { ops_->invoke(storage_); }
+
+    explicit operator bool() const noexcept { return ops_ != nullptr; }
+
+    // Destroy the callable now; the task becomes empty
+    void reset() noexcept {
+        if (ops_) {
+            ops_->destroy(storage_);
+            ops_ = nullptr;
+        }
+    }
+
+private:
+    struct Ops {
+        void (*invoke)(void* storage);
+        void (*move)(void* to, void* from) noexcept; // Move-constructs into `to` and destroys `from`
+        void (*destroy)(void* storage) noexcept;
+    };
+
+    template <typename Fn>
+    static constexpr Ops inlineOps = {
+        [](void* s) { (*static_cast<Fn*>(s))(); },
+        [](void* to, void* from) noexcept {
+            ::new (to) Fn(std::move(*static_cast<Fn*>(from)));
+            static_cast<Fn*>(from)->~Fn();
+        },
+        [](void* s) noexcept { static_cast<Fn*>(s)->~Fn(); },
+    };
+
+    template <typename Fn>
+    static constexpr Ops heapOps = {
+        [](void* s) { (**static_cast<Fn**>(s))(); },
+        [](void* to, void* from) noexcept { ::new (to) Fn*(*static_cast<Fn**>(from)); },
+        [](void* s) noexcept { delete *static_cast<Fn**>(s); },
+    };
+
+    alignas(std::max_align_t) unsigned char storage_[InlineSize];
+    const Ops* ops_ = nullptr;
+
+    void moveFrom(InplaceTask& other) noexcept {
+        if (other.ops_) {
+            other.ops_->move(storage_, other.storage_);
+            ops_ = other.ops_;
+            other.ops_ = nullptr;
+        }
+    }
+};
@@ -0,0 +1,315 @@
+#pragma once
+
+/*
+Keyed (multi-tenant) rate limiter
+
+One limit per key (API key, tenant id, ...) for millions of keys. A RateLimiter object per key would
+cost a mutex, a time_point and several ints each, so per-key state here is a single 32-bit word next to
+the key in a concurrent open-addressing hash table.
+
+Algorithm: GCRA (generic cell rate algorithm)
+The only per-key state is the theoretical arrival time (TAT): the time at which the key's bucket
+would be full again. A request of weight `cost` is admitted when
+	max(TAT, now) + cost * interval - now <= burst * interval
+and then moves TAT to max(TAT, now) + cost * interval, where interval = 1 / ratePerSec. This is
+exactly a token bucket of `burst` tokens refilled at ratePerSec, stored in one number.
+
+Table layout
+Slots are grouped four to a 48-byte Group: four 64-bit keys, then four 32-bit state words, so a
+slot costs 12 bytes and, at the table's load factor of at most 0.8, a key costs 15.
+The state word holds a 3-bit slot generation and a 29-bit TAT. The TAT counts units of
+interval / 8, so every admitted request moves it by exactly 8 * cost units: the enforced rate has
+no rounding error, and `now` is only quantized to 1/8 of a token. The TAT wraps around: it is
+compared with now modulo 2^29, which is right as long as no live key's TAT is more than 2^28 units
+(2^25 intervals: 33s at 1M/s per key, 3.9 days at 100/s) away from now. Keys in the future are at
+most burst intervals ahead (burst is limited to 2^22), and keys in the past are evicted long
+before, see below.
+•	Known keys are served lock-free: load the key, load the state, one CAS on the state word.
+•	New keys and evictions take one mutex. New keys claim the first empty slot of their probe
+	sequence; the table holds no tombstones, so a lookup for a new key stops after the normal
+	linear-probing distance.
+•	A key whose TAT is in the past has a full bucket, which is the same as not being in the table, so
+	evicting it loses nothing. evictIdle() walks a shared cursor over a few slots at a time and evicts
+	keys idle for longer than idleTimeout (at most 2^26 units) with backward-shift deletion: the
+	following keys of the probe run move back into the hole, and the run ends with an empty slot
+	again. Every insertion sweeps kSweepPerInsert slots, so eviction keeps pace with the arrival of
+	new keys without a background thread. If no pass over the table has completed within 2^26 units,
+	the next tryConsume() sweeps the whole table first, so no TAT gets old enough to wrap; after a
+	quiet period of more than 2^27 units every bucket is full and the table is simply cleared.
+•	Eviction and moves bump the slot generation in the state word, so a reader that raced with them
+	fails its CAS instead of charging the slot's next owner. A moved key is stored at its new slot
+	before it disappears from the old one; a reader that misses it during the move falls back to the
+	locked insert path, which finds it.
+
+Keys are 64-bit; the two largest values are reserved as the empty and tombstone markers.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+class KeyedRateLimiter {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // burst must be at least 1 and at most 2^22
+    KeyedRateLimiter(std::size_t maxKeys, double ratePerSec, uint64_t burst,
+                     Clock::duration idleTimeout = std::chrono::seconds(60))
+        : origin_(Clock::now()),
+          maxKeys_(maxKeys),
+          size_((maxKeys + maxKeys / 4 + 16 + kGroupSlots - 1) / kGroupSlots * kGroupSlots),
+          groups_(new Group[size_ / kGroupSlots]),
+          unitsPerNs_(ratePerSec * kUnitsPerToken / 1e9),
+          burstUnits_(static_cast<int64_t>(burst) * kUnitsPerToken),
+          idleUnits_(std::min<double>(kHorizon / 4, std::chrono::duration<double>(idleTimeout).count() * 1e9 * unitsPerNs_)) {
+        if (!(ratePerSec > 0) || burst == 0 || burst > (uint64_t{1} << 22)) {
+            throw std::invalid_argument("KeyedRateLimiter: rate must be positive and burst in [1, 2^22]");
+        }
+        for (std::size_t i = 0; i < size_; ++i) {
+            key(i).store(kEmpty, std::memory_order_relaxed);
+            state(i).store(kVacant, std::memory_order_relaxed);
+        }
+    }
+
+    KeyedRateLimiter(const KeyedRateLimiter&) = delete;
+    KeyedRateLimiter& operator=(const KeyedRateLimiter&) = delete;
+
+    // Admit a request of weight `cost` for `key` if the key's bucket holds that many tokens.
+    // Returns false as well when the table is full of active keys.
+    bool tryConsume(uint64_t k, uint64_t cost = 1) {
+        int64_t step = static_cast<int64_t>(std::min<uint64_t>(cost, uint64_t{1} << 32)) * kUnitsPerToken;
+        if (step > burstUnits_) {
+            return false;
+        }
+        int64_t now = nowUnits();
+        if (now - lapStart_.load(std::memory_order_relaxed) > kHorizon / 4) {
+            sweepIfStale(now); // Eviction fell behind (no inserts lately): catch up before decoding TATs
+        }
+
+        while (true) {
+            std::size_t i = find(k);
+            if (i == kNone) {
+                i = insert(k, now);
+                if (i == kNone) {
+                    return false;
+                }
+            }
+
+            uint32_t s = state(i).load(std::memory_order_acquire);
+            while (key(i).load(std::memory_order_acquire) == k && !isVacant(s)) {
+                int64_t debt = std::max<int64_t>(0, ahead(s, now));
+                if (debt + step > burstUnits_) {
+                    return false;
+                }
+                if (state(i).compare_exchange_weak(s, withTat(s, now + debt + step), std::memory_order_acq_rel,
+                                                   std::memory_order_acquire)) {
+                    return true;
+                }
+            }
+            // The slot was evicted or moved under us; look the key up again
+        }
+    }
+
+    // Evict the idle keys among the next `maxSlots` slots, continuing where the last call stopped.
+    // Returns the number of keys evicted.
+    std::size_t evictIdle(std::size_t maxSlots) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return evictLocked(maxSlots, nowUnits());
+    }
+
+    std::size_t size() const { return live_.load(std::memory_order_relaxed); }
+    std::size_t slotCount() const { return size_; }
+
+    // Heap bytes used by the table
+    std::size_t memoryBytes() const { return size_ / kGroupSlots * sizeof(Group); }
+
+private:
+    static constexpr uint64_t kEmpty = UINT64_MAX;
+    static constexpr uint64_t kTombstone = UINT64_MAX - 1; // Only inside a backward shift, under mutex_
+    static constexpr std::size_t kNone = SIZE_MAX;
+    static constexpr int64_t kUnitsPerToken = 8;
+    static constexpr unsigned kTatBits = 29;
+    static constexpr uint32_t kTatMask = (uint32_t{1} << kTatBits) - 1;
+    static constexpr int64_t kHorizon = int64_t{1} << (kTatBits - 1); // Largest |TAT - now| that decodes right
+    static constexpr uint32_t kVacantTat = kTatMask; // TAT value marking a slot without a live key
+    static constexpr uint32_t kVacant = kVacantTat;  // Generation 0, vacant
+    static constexpr std::size_t kGroupSlots = 4;
+    static constexpr std::size_t kSweepPerInsert = 16;
+
+    struct Group {
+        std::atomic<uint64_t> keys[kGroupSlots];
+        std::atomic<uint32_t> states[kGroupSlots]; // generation:3 | tat:29
+    };
+    static_assert(sizeof(Group) == 48, "a slot should cost 12 bytes");
+
+    const Clock::time_point origin_;
+    const std::size_t maxKeys_;
+    const std::size_t size_; // Slots, a multiple of kGroupSlots; sized for a load factor of at most 0.8
+    std::unique_ptr<Group[]> groups_;
+    const double unitsPerNs_;
+    const int64_t burstUnits_;
+    const int64_t idleUnits_;
+    std::mutex mutex_; // Inserts and evictions
+    std::size_t cursor_ = 0; // Next slot for evictLocked(), under mutex_
+    std::atomic<int64_t> lapStart_{0}; // When the eviction cursor last started a pass over the table
+    std::atomic<std::size_t> live_{0};
+
+    static uint64_t hash(uint64_t x) {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebULL;
+        x ^= x >> 31;
+        return x;
+    }
+
+    std::atomic<uint64_t>& key(std::size_t i) const { return groups_[i / kGroupSlots].keys[i % kGroupSlots]; }
+    std::atomic<uint32_t>& state(std::size_t i) const { return groups_[i / kGroupSlots].states[i % kGroupSlots]; }
+
+    static bool isVacant(uint32_t s) { return (s & kTatMask) == kVacantTat; }
+    // How far the TAT is ahead of now (negative: in the past), modulo 2^29
+    static int64_t ahead(uint32_t s, int64_t now) {
+        uint32_t diff = ((s & kTatMask) - static_cast<uint32_t>(now)) & kTatMask;
+        return diff >= (uint32_t{1} << (kTatBits - 1)) ? static_cast<int64_t>(diff) - (int64_t{1} << kTatBits) : diff;
+    }
+    static uint32_t withTat(uint32_t s, int64_t tat) {
+        uint32_t t = static_cast<uint32_t>(tat) & kTatMask;
+        if (t == kVacantTat) {
+            t = 0; // One unit later than asked, so a live TAT never reads as vacant
+        }
+        return (s & ~kTatMask) | t;
+    }
+    // Same generation bumped, so stale CASes from before the eviction or move fail
+    static uint32_t nextGeneration(uint32_t s, uint32_t tat) { return ((s & ~kTatMask) + (kTatMask + 1)) | tat; }
+
+    int64_t nowUnits() const {
+        return static_cast<int64_t>(static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - origin_).count()) * unitsPerNs_);
+    }
+
+    // Home slot without requiring a power-of-two table: multiply-shift range reduction
+    std::size_t home(uint64_t k) const {
+        return static_cast<std::size_t>((static_cast<unsigned __int128>(hash(k)) * size_) >> 64);
+    }
+
+    std::size_t next(std::size_t i) const { return i + 1 == size_ ? 0 : i + 1; }
+
+    std::size_t find(uint64_t k) const {
+        std::size_t i = home(k);
+        for (std::size_t probes = 0; probes < size_; ++probes, i = next(i)) {
+            uint64_t found = key(i).load(std::memory_order_acquire);
+            if (found == k) {
+                return i;
+            }
+            if (found == kEmpty) {
+                return kNone;
+            }
+        }
+        return kNone;
+    }
+
+    std::size_t insert(uint64_t k, int64_t now) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        evictLocked(kSweepPerInsert, now);
+        std::size_t found = find(k);
+        if (found != kNone) {
+            return found; // Inserted by another thread meanwhile, or moved while we looked
+        }
+        if (live_.load(std::memory_order_relaxed) >= maxKeys_) {
+            evictLocked(size_, now); // Full of live keys: sweep the whole table once
+            if (live_.load(std::memory_order_relaxed) >= maxKeys_) {
+                return kNone;
+            }
+        }
+        std::size_t i = home(k);
+        while (key(i).load(std::memory_order_relaxed) != kEmpty) {
+            i = next(i);
+        }
+        // State before key, so a reader that sees the key sees a live state. A fresh key starts
+        // with a full bucket: its TAT is now.
+        state(i).store(nextGeneration(state(i).load(std::memory_order_relaxed), withTat(0, now)), std::memory_order_release);
+        key(i).store(k, std::memory_order_release);
+        live_.fetch_add(1, std::memory_order_relaxed);
+        return i;
+    }
+
+    // Under mutex_: the whole-table pass tryConsume() falls back to when eviction has fallen behind.
+    // A pass normally finishes within kHorizon / 4 of the previous one, so every live TAT is within
+    // kHorizon / 2 of lapStart_. If no call came for long enough that now is more than kHorizon / 2
+    // past it, no key has been charged for at least kHorizon / 4 either: every bucket is full and
+    // the whole table is dropped without decoding TATs that may have wrapped.
+    void sweepIfStale(int64_t now) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        int64_t behind = now - lapStart_.load(std::memory_order_relaxed);
+        if (behind > kHorizon / 2) {
+            for (std::size_t i = 0; i < size_; ++i) {
+                uint32_t s = state(i).load(std::memory_order_relaxed);
+                if (!isVacant(s)) {
+                    state(i).store(nextGeneration(s, kVacantTat), std::memory_order_release);
+                }
+            }
+            for (std::size_t i = 0; i < size_; ++i) {
+                key(i).store(kEmpty, std::memory_order_release);
+            }
+            live_.store(0, std::memory_order_relaxed);
+            lapStart_.store(now, std::memory_order_relaxed);
+        } else if (behind > kHorizon / 4) {
+            evictLocked(size_, now);
+        }
+    }
+
+    // Under mutex_
+    std::size_t evictLocked(std::size_t maxSlots, int64_t now) {
+        std::size_t evicted = 0;
+        std::size_t i = cursor_;
+        for (std::size_t n = 0; n < maxSlots;) {
+            uint64_t k = key(i).load(std::memory_order_relaxed);
+            uint32_t s = state(i).load(std::memory_order_acquire);
+            // The shift may move another key into slot i, so it is looked at again before moving on
+            if (k != kEmpty && ahead(s, now) < -idleUnits_ &&
+                state(i).compare_exchange_strong(s, nextGeneration(s, kVacantTat), std::memory_order_acq_rel)) {
+                removeAt(i);
+                ++evicted;
+                continue;
+            }
+            i = next(i);
+            ++n;
+            if (i == 0) {
+                lapStart_.store(now, std::memory_order_relaxed); // A pass over the table is complete
+            }
+        }
+        cursor_ = i;
+        return evicted;
+    }
+
+    // Under mutex_: slot i's state is already vacant; close the hole with backward-shift deletion
+    void removeAt(std::size_t hole) {
+        live_.fetch_sub(1, std::memory_order_relaxed);
+        key(hole).store(kTombstone, std::memory_order_release); // Lookups keep probing past it meanwhile
+        for (std::size_t j = next(hole);; j = next(j)) {
+            uint64_t k = key(j).load(std::memory_order_relaxed);
+            if (k == kEmpty) {
+                break;
+            }
+            std::size_t h = home(k);
+            // The key at j may move to the hole if its home is not cyclically within (hole, j]
+            bool stays = hole < j ? (h > hole && h <= j) : (h > hole || h <= j);
+            if (stays) {
+                continue;
+            }
+            // Retire the old slot's state first, so no CAS lands there after the copy
+            uint32_t s = state(j).load(std::memory_order_acquire);
+            while (!state(j).compare_exchange_weak(s, nextGeneration(s, kVacantTat), std::memory_order_acq_rel)) {
+            }
+            state(hole).store(nextGeneration(state(hole).load(std::memory_order_relaxed), s & kTatMask), std::memory_order_release);
+            key(hole).store(k, std::memory_order_release);
+            key(j).store(kTombstone, std::memory_order_release);
+            hole = j;
+        }
+        key(hole).store(kEmpty, std::memory_order_release);
+    }
+};
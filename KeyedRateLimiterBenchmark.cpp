@@ -0,0 +1,98 @@
+/*
+KeyedRateLimiter benchmark
+
+For each key count N:
+•	insert: first request for each of N keys (the locked insert path).
+•	steady: random requests over the N known keys from T threads (the lock-free path).
+•	churn:  2N brand-new keys pushed through a table sized for N keys; incremental eviction has to
+	recycle slots of keys gone idle for the insertions to keep succeeding.
+Memory per key counts the whole table, load factor included.
+
+Then churn rounds: a table for 100000 keys with a 1ms idle timeout takes 100000 new keys per round,
+with the previous round's keys gone idle in between. The cost of a new key must stay flat from
+round to round; a table that leaves tombstones behind slows down as they pile up.
+
+Usage: KeyedRateLimiterBenchmark [threads] [keys ...]   (default: hardware threads, 1000000 10000000)
+*/
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+#include "KeyedRateLimiter.h"
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+constexpr std::size_t kSteadyOpsPerThread = 2000000;
+
+double seconds(Clock::duration d) {
+    return std::chrono::duration<double>(d).count();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    unsigned threads = argc > 1 ? static_cast<unsigned>(std::atoi(argv[1])) : std::thread::hardware_concurrency();
+    if (threads == 0) threads = 1;
+    std::vector<std::size_t> keyCounts;
+    for (int i = 2; i < argc; ++i) keyCounts.push_back(std::strtoull(argv[i], nullptr, 10));
+    if (keyCounts.empty()) keyCounts = {1000000, 10000000};
+
+    std::printf("%-10s %10s %14s %14s %14s %14s\n", "keys", "bytes/key", "insert Mops/s", "steady Mops/s",
+                "churn Mops/s", "churn denied");
+    for (std::size_t keys : keyCounts) {
+        // 100 requests per second per key, bursts of 10
+        KeyedRateLimiter limiter(keys, 100.0, 10);
+
+        auto start = Clock::now();
+        for (uint64_t k = 0; k < keys; ++k) {
+            limiter.tryConsume(k);
+        }
+        double insertRate = static_cast<double>(keys) / seconds(Clock::now() - start);
+
+        std::vector<std::thread> workers;
+        start = Clock::now();
+        for (unsigned t = 0; t < threads; ++t) {
+            workers.emplace_back([&limiter, keys, t]() {
+                std::mt19937_64 rng(t + 1);
+                for (std::size_t i = 0; i < kSteadyOpsPerThread; ++i) {
+                    limiter.tryConsume(rng() % keys, 1 + (i & 1));
+                }
+            });
+        }
+        for (auto& w : workers) w.join();
+        double steadyRate = static_cast<double>(kSteadyOpsPerThread * threads) / seconds(Clock::now() - start);
+
+        // Keys idle for more than 1ms at 1M/s may be evicted, so slots recycle quickly
+        KeyedRateLimiter churn(keys, 1e6, 1, std::chrono::milliseconds(1));
+        std::size_t denied = 0;
+        start = Clock::now();
+        for (uint64_t k = 0; k < 2 * keys; ++k) {
+            denied += churn.tryConsume(k) ? 0 : 1;
+        }
+        double churnRate = static_cast<double>(2 * keys) / seconds(Clock::now() - start);
+
+        std::printf("%-10zu %10.1f %14.2f %14.2f %14.2f %14zu\n", keys,
+                    static_cast<double>(limiter.memoryBytes()) / static_cast<double>(keys), insertRate / 1e6,
+                    steadyRate / 1e6, churnRate / 1e6, denied);
+    }
+
+    constexpr std::size_t kRoundKeys = 100000;
+    KeyedRateLimiter rounds(kRoundKeys, 1e6, 1, std::chrono::milliseconds(1));
+    std::printf("\nchurn rounds (%zu new keys each), ns per new key:", kRoundKeys);
+    for (uint64_t round = 0; round < 8; ++round) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        auto start = Clock::now();
+        for (uint64_t k = 0; k < kRoundKeys; ++k) {
+            rounds.tryConsume(round * kRoundKeys + k);
+        }
+        std::printf(" %.0f", seconds(Clock::now() - start) * 1e9 / kRoundKeys);
+    }
+    std::printf("\n");
+    return 0;
+}
@@ -31,9 +31,24 @@ Note:
 
 We do not know how the threads will be scheduled in the operating system, even though the numbers in the
 input seems to imply the ordering. The input format you see is mainly to ensure our tests' comprehensiveness.
+---
+Each approach lives in its own namespace (lc1114::mutex_cv, lc1114::volatile_yield, lc1114::semaphore,
+lc1114::atomic_spin, lc1114::turn_sequencer) so the Foo classes compile side by side;
+PrimitivesBenchmark.cpp includes this file and measures them against each other.
 */
 
-//Approach 1 0f 4: Using Mutex and Condition Variables.
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <semaphore.h>
+#include "TurnSequencer.h"
+
+namespace lc1114 {
+
+//Approach 1 0f 5: Using Mutex and Condition Variables.
+namespace mutex_cv {
 class Foo 
 {
     std::condition_variable cv;
@@ -44,7 +59,7 @@ public:
     Foo() {
     }
 
-    void first(function<void()> printFirst) {
+    void first(std::function<void()> printFirst) {
         {
           std::unique_lock lock(mutex);
           cv.wait(lock, [&](){return spWakeUp == 1; });
@@ -53,7 +68,7 @@ public:
        }
        cv.notify_all();
    }
-    void second(function<void()> printSecond) {
+    void second(std::function<void()> printSecond) {
         {
            std::unique_lock lock(mutex);
            cv.wait(lock, [&](){return spWakeUp == 2; });
@@ -63,7 +78,7 @@ public:
         cv.notify_all();
     }
 
-    void third(function<void()> printThird) {
+    void third(std::function<void()> printThird) {
         {
             std::unique_lock lock(mutex);
             cv.wait(lock, [&](){return spWakeUp == 3; });
@@ -73,9 +88,10 @@ public:
         cv.notify_all();
     }
 };
+} // namespace mutex_cv
 
-//Approach 2 of 4: using Volatile
-
+//Approach 2 of 5: using Volatile
+namespace volatile_yield {
 class Foo {
     volatile int count;
     
@@ -84,13 +100,13 @@ public:
         
     }
 
-    void first(function<void()> printFirst) {
+    void first(std::function<void()> printFirst) {
         
         printFirst();
-        count++;
+        count = count + 1;
     }
 
-    void second(function<void()> printSecond) {
+    void second(std::function<void()> printSecond) {
               
         while(count != 2)
         {
@@ -98,10 +114,10 @@ public:
         }
         
         printSecond();
-        count++;
+        count = count + 1;
     }
 
-    void third(function<void()> printThird) {
+    void third(std::function<void()> printThird) {
         
         while(count != 3)
         {
@@ -112,45 +128,48 @@ public:
         
     }
 };
+} // namespace volatile_yield
 
-//Approach 3 0f 4: Using `semaphone`
-#include <semaphore.h>
+//Approach 3 0f 5: Using `semaphone`
+namespace semaphore {
 class Foo {
-    sem_t second;
-    sem_t third;
+    sem_t secondSem;
+    sem_t thirdSem;
     
 public:
-    Foo() : {
-        sem_init(&second, 0, 0);
-        sem_init(&third, 0, 0);
+    Foo() {
+        sem_init(&secondSem, 0, 0);
+        sem_init(&thirdSem, 0, 0);
     }
 
     ~Foo()
     {
-        sem_destroy(&second);
-        sem_destroy(&third);
+        sem_destroy(&secondSem);
+        sem_destroy(&thirdSem);
     }
-    void first(function<void()> printFirst) {
+    void first(std::function<void()> printFirst) {
         
         printFirst();
-        sem_post(&second);
+        sem_post(&secondSem);
     }
 
-    void second(function<void()> printSecond) {
+    void second(std::function<void()> printSecond) {
         
-        sem_wait(&second);
+        sem_wait(&secondSem);
         printSecond();
-        sem_post(&third);
+        sem_post(&thirdSem);
     }
 
-    void third(function<void()> printThird) {
+    void third(std::function<void()> printThird) {
         
-        sem_wait(&third)
+        sem_wait(&thirdSem);
         printThird();
     }
 };
+} // namespace semaphore
 
-//Approach 4 0f 4: Using `atomic`
+//Approach 4 0f 5: Using `atomic`
+namespace atomic_spin {
 class Foo {
     std::atomic<int> count;
     
@@ -159,13 +178,13 @@ public:
         
     }
 
-    void first(function<void()> printFirst) {
+    void first(std::function<void()> printFirst) {
         
         printFirst();
         count.store(2, std::memory_order_release);
     }
 
-    void second(function<void()> printSecond) {
+    void second(std::function<void()> printSecond) {
         
         while(count != 2)
         {     }
@@ -174,7 +193,7 @@ public:
         count.store(3, std::memory_order_release);
     }
 
-    void third(function<void()> printThird) {
+    void third(std::function<void()> printThird) {
         
         while(count != 3)
         {     }
@@ -182,3 +201,26 @@ public:
         printThird();
     }
 };
+} // namespace atomic_spin
+
+//Approach 5 of 5: Using `TurnSequencer` (spin briefly, then park on a futex; see TurnSequencer.h)
+namespace turn_sequencer {
+class Foo {
+    TurnSequencer turns{3};
+
+public:
+    void first(std::function<void()> printFirst) {
+        turns.runTurn(0, printFirst);
+    }
+
+    void second(std::function<void()> printSecond) {
+        turns.runTurn(1, printSecond);
+    }
+
+    void third(std::function<void()> printThird) {
+        turns.runTurn(2, printThird);
+    }
+};
+} // namespace turn_sequencer
+
+} // namespace lc1114
@@ -31,11 +31,24 @@ Example 2:
 Input: n = 2
 Output: "foobarfoobar"
 Explanation: "foobar" is being output 2 times.
+---
+Each approach lives in its own namespace (lc1115::semaphore, lc1115::mutex_cv, lc1115::volatile_yield,
+lc1115::turn_sequencer) so the FooBar classes compile side by side; PrimitivesBenchmark.cpp includes
+this file and measures them against each other.
 */
 
-//Approach 1: using 'semaphore'
+#include <condition_variable>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <thread>
 #include <semaphore.h>
+#include "TurnSequencer.h"
+
+namespace lc1115 {
 
+//Approach 1: using 'semaphore'
+namespace semaphore {
 class FooBar 
 {
 private:
@@ -48,9 +61,9 @@ public:
         this->n = n;
         sem_init(&foo_sem, 0, 1);
         sem_init(&bar_sem, 0, 0);
-        ios_base::sync_with_stdio(false);
-        cin.tie(NULL);
-        cout.tie(NULL);
+        std::ios_base::sync_with_stdio(false);
+        std::cin.tie(NULL);
+        std::cout.tie(NULL);
     }
 
     ~FooBar()
@@ -58,7 +71,7 @@ public:
         sem_destroy(&foo_sem);
         sem_destroy(&bar_sem);
     }
-    void foo(function<void()> printFoo) 
+    void foo(std::function<void()> printFoo) 
     {    
         for (int i = 0; i < n; i++) 
         {    
@@ -69,7 +82,7 @@ public:
         }
     }
 
-    void bar(function<void()> printBar) {
+    void bar(std::function<void()> printBar) {
         
         for (int i = 0; i < n; i++) {
             sem_wait(&bar_sem);
@@ -79,8 +92,10 @@ public:
         }
     }
 };
+} // namespace semaphore
 
 //Approach 2: using 'mutex and condition variable'
+namespace mutex_cv {
 class FooBar 
 {
 private:
@@ -93,7 +108,7 @@ public:
         this->n = n;
     }
 
-    void foo(function<void()> printFoo) {
+    void foo(std::function<void()> printFoo) {
         
         for (int i = 0; i < n; i++) {
             
@@ -106,7 +121,7 @@ public:
         }
     }
 
-    void bar(function<void()> printBar) {
+    void bar(std::function<void()> printBar) {
         
         for (int i = 0; i < n; i++) {
             
@@ -119,9 +134,10 @@ public:
         }
     }
 };
+} // namespace mutex_cv
 
 //Approach 3: using 'volatile'
-
+namespace volatile_yield {
 class FooBar 
 {
 private:
@@ -132,7 +148,7 @@ public:
         this->n = n;
     }
 
-    void foo(function<void()> printFoo) {
+    void foo(std::function<void()> printFoo) {
         
         for (int i = 0; i < n; i++) {
             
@@ -142,11 +158,11 @@ public:
             }
         	// printFoo() outputs "foo". Do not change or remove this line.
         	printFoo();
-            ++barrier;
+            barrier = barrier + 1;
         }
     }
 
-    void bar(function<void()> printBar) {
+    void bar(std::function<void()> printBar) {
         
         for (int i = 0; i < n; i++) {
             
@@ -156,7 +172,58 @@ public:
             }
         	// printBar() outputs "bar". Do not change or remove this line.
         	printBar();
-            --barrier;
+            barrier = barrier - 1;
         }
     }
 };
+} // namespace volatile_yield
+
+//Approach 4: using 'TurnSequencer', which also covers longer cycles such as foo/bar/baz
+namespace turn_sequencer {
+class FooBar
+{
+private:
+    int n;
+    TurnSequencer turns{2};
+public:
+    FooBar(int n) : n(n) {
+    }
+
+    void foo(std::function<void()> printFoo) {
+        for (int i = 0; i < n; i++) {
+            turns.runTurn(turns.turnOf(0, i), printFoo);
+        }
+    }
+
+    void bar(std::function<void()> printBar) {
+        for (int i = 0; i < n; i++) {
+            turns.runTurn(turns.turnOf(1, i), printBar);
+        }
+    }
+};
+
+// Three threads printing "foobarbaz" n times
+class FooBarBaz
+{
+private:
+    int n;
+    TurnSequencer turns{3};
+public:
+    FooBarBaz(int n) : n(n) {
+    }
+
+    void foo(std::function<void()> printFoo) {
+        for (int i = 0; i < n; i++) turns.runTurn(turns.turnOf(0, i), printFoo);
+    }
+
+    void bar(std::function<void()> printBar) {
+        for (int i = 0; i < n; i++) turns.runTurn(turns.turnOf(1, i), printBar);
+    }
+
+    void baz(std::function<void()> printBaz) {
+        for (int i = 0; i < n; i++) turns.runTurn(turns.turnOf(2, i), printBaz);
+    }
+};
+} // namespace turn_sequencer
+
+} // namespace lc1115
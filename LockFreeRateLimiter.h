@@ -0,0 +1,262 @@
+#pragma once
+
+/*
+Lock-free token bucket rate limiter
+
+The RateLimiter classes in TokenBucketRateLimiter.cpp store (tokens, lastRefillTime) and need a mutex
+to update both together. This limiter stores a single 64-bit value instead: the virtual instant at
+which the bucket would be empty ("emptyAt"). The number of tokens at time `now` is
+(now - emptyAt) / costPerToken, capped at maxTokens, so refilling is implicit and consuming is one CAS
+that moves emptyAt forward by n * costPerToken. Time is kept in fixed point (1/16 ns since the
+limiter was created), which keeps the rounding error of costPerToken below 0.032ns per token and
+lasts 18 years in a signed 64-bit value. The constructor throws std::invalid_argument for a rate
+above 16e9 tokens/s (costPerToken would round to 0) or a burst, maxTokens * costPerToken, above
+2^61 fixed-point units (4.5 years of refill), which leaves headroom for the arithmetic around it.
+A request for more than maxTokens tokens can never be granted: tryConsume() returns false and
+reserve() throws std::invalid_argument.
+
+Sharded mode
+With shards > 0 every shard (one per CPU by default, picked with sched_getcpu) keeps a local pool of
+whole tokens on its own cache line. tryConsume() takes tokens from the local pool; when it runs dry it
+draws a batch of up to `batch` tokens from the global bucket with one CAS, and when the global bucket
+is empty it steals from the other shards. Every rebalanceInterval, the first thread to notice hands all
+shard-local tokens back to the global bucket, so tokens do not pile up in idle shards.
+
+Accuracy
+•	Unsharded: over any window of length t at most maxTokens + rate * t tokens are granted.
+•	Sharded: tokens are only ever created by the global bucket, so the same bound holds plus the tokens
+	parked in shards: at most maxTokens + rate * t + shards * batch. Stealing means tokens parked in
+	shards are never lost while somebody is asking for them.
+
+EmptyAtBucket below is that arithmetic and its range checks on an atomic word owned by the caller.
+SharedRateLimiter.h uses it for the unsharded bucket in POSIX shared memory, one budget for several
+processes.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <sched.h>
+
+// The emptyAt token bucket on a caller-owned atomic word; times are fixed point, kFixedOne per ns
+class EmptyAtBucket {
+public:
+    static constexpr int64_t kFixedOne = 16;               // Fixed-point units per nanosecond
+    static constexpr int64_t kMaxBurst = int64_t{1} << 61; // Largest maxTokens * costPerToken
+
+    // Throws std::invalid_argument if the rate or maxTokens * costPerToken is out of range
+    EmptyAtBucket(std::size_t maxTokens, double refillRatePerSec)
+        : costPerToken_(costFor(refillRatePerSec)), burst_(burstFor(maxTokens, costPerToken_)) {}
+
+    int64_t costPerToken() const { return costPerToken_; }
+    int64_t burst() const { return burst_; }
+
+    // Whether `tokens` can ever be granted at once, i.e. tokens <= maxTokens
+    bool fits(uint64_t tokens) const { return tokens <= static_cast<uint64_t>(burst_ / costPerToken_); }
+
+    // Take between `least` and `most` tokens at time t; returns how many were taken (0 or >= least)
+    int64_t take(std::atomic<int64_t>& emptyAt, int64_t t, int64_t least, int64_t most) const {
+        int64_t current = emptyAt.load(std::memory_order_relaxed);
+        while (true) {
+            int64_t base = std::max(current, t - burst_);
+            int64_t available = (t - base) / costPerToken_;
+            if (available < least) {
+                return 0;
+            }
+            int64_t take = std::min(available, most);
+            if (emptyAt.compare_exchange_weak(current, base + take * costPerToken_, std::memory_order_acq_rel,
+                                              std::memory_order_relaxed)) {
+                return take;
+            }
+        }
+    }
+
+    // Book `tokens` tokens at time t and return the time they exist; throws std::invalid_argument
+    // if they do not fit
+    int64_t reserve(std::atomic<int64_t>& emptyAt, int64_t t, uint64_t tokens) const {
+        if (!fits(tokens)) {
+            throw std::invalid_argument("EmptyAtBucket: reserve of more than maxTokens");
+        }
+        int64_t n = static_cast<int64_t>(tokens);
+        int64_t current = emptyAt.load(std::memory_order_relaxed);
+        int64_t next;
+        do {
+            next = std::max(current, t - burst_) + n * costPerToken_;
+        } while (!emptyAt.compare_exchange_weak(current, next, std::memory_order_acq_rel, std::memory_order_relaxed));
+        // The tokens exist once the bucket's empty point has reached them: at `next`
+        return std::max(next, t);
+    }
+
+    // Whole tokens in the bucket at time t
+    uint64_t available(const std::atomic<int64_t>& emptyAt, int64_t t) const {
+        int64_t base = std::max(emptyAt.load(std::memory_order_acquire), t - burst_);
+        return static_cast<uint64_t>((t - base) / costPerToken_);
+    }
+
+    static int64_t toFixed(std::chrono::nanoseconds d) { return d.count() * kFixedOne; }
+
+    // Rounds up, so a caller sleeping until the result never wakes before the tokens exist
+    static std::chrono::nanoseconds fromFixed(int64_t t) {
+        return std::chrono::nanoseconds((t + kFixedOne - 1) / kFixedOne);
+    }
+
+private:
+    const int64_t costPerToken_; // Fixed-point time that refills one token
+    const int64_t burst_;        // Fixed-point time that refills the whole bucket
+
+    static int64_t costFor(double refillRatePerSec) {
+        double cost = 1e9 * kFixedOne / refillRatePerSec + 0.5;
+        if (!(refillRatePerSec > 0) || !(cost >= 1) || !(cost <= static_cast<double>(kMaxBurst))) {
+            throw std::invalid_argument("EmptyAtBucket: refillRatePerSec out of range");
+        }
+        return static_cast<int64_t>(cost);
+    }
+
+    static int64_t burstFor(std::size_t maxTokens, int64_t costPerToken) {
+        if (maxTokens > static_cast<uint64_t>(kMaxBurst / costPerToken)) {
+            throw std::invalid_argument("EmptyAtBucket: maxTokens * refill time overflows");
+        }
+        return static_cast<int64_t>(maxTokens) * costPerToken;
+    }
+};
+
+class LockFreeRateLimiter {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Unsharded: every tryConsume() is a CAS on the one global word
+    LockFreeRateLimiter(std::size_t maxTokens, double refillRatePerSec)
+        : LockFreeRateLimiter(maxTokens, refillRatePerSec, 0, 0) {}
+
+    // Sharded: `shards` local pools refilled `batch` tokens at a time
+    LockFreeRateLimiter(std::size_t maxTokens, double refillRatePerSec, std::size_t shards, std::size_t batch,
+                        Clock::duration rebalanceInterval = std::chrono::milliseconds(10))
+        : origin_(Clock::now()),
+          bucket_(maxTokens, refillRatePerSec),
+          batch_(static_cast<int64_t>(std::max<std::size_t>(batch, 1))),
+          rebalanceInterval_(toFixed(rebalanceInterval)),
+          shardCount_(shards),
+          shards_(shards ? new Shard[shards] : nullptr) {
+        // Start full: the bucket has been "filling" for maxTokens * costPerToken already
+        emptyAt_.store(-bucket_.burst(), std::memory_order_relaxed);
+    }
+
+    static std::size_t defaultShards() {
+        unsigned n = std::thread::hardware_concurrency();
+        return n ? n : 1;
+    }
+
+    // Take `tokens` tokens if they are available right now; never more than maxTokens
+    bool tryConsume(uint64_t tokens = 1) {
+        if (!bucket_.fits(tokens)) {
+            return false;
+        }
+        int64_t n = static_cast<int64_t>(tokens);
+        if (shardCount_ == 0) {
+            return bucket_.take(emptyAt_, now(), n, n) == n;
+        }
+        return tryConsumeSharded(n);
+    }
+
+    // Take `tokens` tokens whether or not they are there, and return when they are: now if the bucket
+    // held them, otherwise the instant the refill catches up. One CAS; reservations are served in
+    // the order they were made, each after the previous one. Only the global bucket is used, also in
+    // sharded mode. Coroutines.h sleeps until the returned time instead of polling tryConsume().
+    // Throws std::invalid_argument for more than maxTokens tokens.
+    Clock::time_point reserve(uint64_t tokens = 1) {
+        return origin_ + EmptyAtBucket::fromFixed(bucket_.reserve(emptyAt_, now(), tokens));
+    }
+
+    // Hand every shard-local token back to the global bucket
+    void rebalance() {
+        int64_t returned = 0;
+        for (std::size_t i = 0; i < shardCount_; ++i) {
+            returned += shards_[i].tokens.exchange(0, std::memory_order_acq_rel);
+        }
+        if (returned > 0) {
+            // Moving emptyAt back adds tokens; anything above maxTokens is trimmed on the next consume
+            emptyAt_.fetch_sub(returned * bucket_.costPerToken(), std::memory_order_acq_rel);
+        }
+    }
+
+    // Whole tokens in the global bucket right now (excluding shard-local tokens)
+    uint64_t available() const { return bucket_.available(emptyAt_, now()); }
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<int64_t> tokens{0};
+    };
+
+    const Clock::time_point origin_;
+    const EmptyAtBucket bucket_;
+    const int64_t batch_;
+    const int64_t rebalanceInterval_;
+    const std::size_t shardCount_;
+    std::unique_ptr<Shard[]> shards_;
+
+    alignas(64) std::atomic<int64_t> emptyAt_{0};
+    alignas(64) std::atomic<int64_t> lastRebalance_{0};
+
+    static int64_t toFixed(Clock::duration d) {
+        return EmptyAtBucket::toFixed(std::chrono::duration_cast<std::chrono::nanoseconds>(d));
+    }
+
+    int64_t now() const { return toFixed(Clock::now() - origin_); }
+
+    static bool takeLocal(Shard& shard, int64_t n) {
+        int64_t current = shard.tokens.load(std::memory_order_relaxed);
+        while (current >= n) {
+            if (shard.tokens.compare_exchange_weak(current, current - n, std::memory_order_acq_rel,
+                                                   std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::size_t currentShard() const {
+        // sched_getcpu() is cheap but not free; refresh the cached CPU every 64 calls
+        thread_local int cpu = -1;
+        thread_local unsigned calls = 0;
+        if (cpu < 0 || (++calls & 63) == 0) {
+            cpu = sched_getcpu();
+            if (cpu < 0) cpu = 0;
+        }
+        return static_cast<std::size_t>(cpu) % shardCount_;
+    }
+
+    bool tryConsumeSharded(int64_t n) {
+        int64_t t = now();
+        int64_t last = lastRebalance_.load(std::memory_order_relaxed);
+        if (t - last >= rebalanceInterval_ &&
+            lastRebalance_.compare_exchange_strong(last, t, std::memory_order_relaxed)) {
+            rebalance();
+        }
+
+        std::size_t index = currentShard();
+        Shard& local = shards_[index];
+        if (takeLocal(local, n)) {
+            return true;
+        }
+
+        int64_t taken = bucket_.take(emptyAt_, t, n, std::max(n, batch_));
+        if (taken > 0) {
+            if (taken > n) {
+                local.tokens.fetch_add(taken - n, std::memory_order_acq_rel);
+            }
+            return true;
+        }
+
+        for (std::size_t k = 1; k < shardCount_; ++k) {
+            if (takeLocal(shards_[(index + k) % shardCount_], n)) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
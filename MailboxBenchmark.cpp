@@ -0,0 +1,127 @@
+/*
+MpscMailbox vs BlockingQueue: many producers, one consumer
+
+P producers push N messages in total (a 64-bit value: producer id and sequence number) into one
+queue as fast as they can; one consumer drains it. Three consumers are compared:
+•	BlockingQueue, deQueue: one lock round trip per message
+•	BlockingQueue, drainTo: up to 256 messages per lock round trip
+•	MpscMailbox, drainTo: producers claim slots with one fetch_add, the consumer takes everything
+	that is published without any atomic read-modify-write
+The consumer checks that every producer's messages arrive in the order they were sent.
+Reports the throughput in millions of messages per second, producers started to consumer done.
+
+Usage: MailboxBenchmark [messages] [max producers]   (default: 4000000 32)
+---
+Output on a single-core machine (numbers vary by machine):
+producers   BQ deQueue Mmsg/s  BQ drainTo Mmsg/s     Mailbox Mmsg/s
+1                        7.05               6.54              44.77
+2                       16.04              11.93              41.08
+4                       18.34              18.24              36.83
+8                       18.32              23.60              36.10
+16                      17.55              27.79              33.02
+32                      15.17              21.54              27.79
+On one core the producers mostly take turns, so contention shows up as preemption inside the
+locked section rather than as cache-line traffic.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include "BlockingQueue.cpp"
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+constexpr std::size_t batchSize = 256;
+
+uint64_t message(int producer, uint64_t sequence)
+{
+	return static_cast<uint64_t>(producer) << 40 | sequence;
+}
+
+// Checks per-producer FIFO order on the consumer side
+struct OrderCheck
+{
+	std::vector<uint64_t> next;
+	std::size_t errors = 0;
+
+	explicit OrderCheck(int producers) : next(static_cast<std::size_t>(producers), 0) {}
+
+	void operator()(uint64_t value)
+	{
+		uint64_t& expected = next[value >> 40];
+		if ((value & ((uint64_t{ 1 } << 40) - 1)) != expected)
+			++errors;
+		expected = (value & ((uint64_t{ 1 } << 40) - 1)) + 1;
+	}
+};
+
+template <typename Queue, typename Consume>
+double run(Queue& queue, std::size_t messages, int producers, Consume consume)
+{
+	OrderCheck check(producers);
+	auto start = Clock::now();
+	std::vector<std::thread> threads;
+	for (int p = 0; p < producers; ++p)
+	{
+		threads.emplace_back([&, p]() {
+			std::size_t count = messages / static_cast<std::size_t>(producers) + (static_cast<std::size_t>(p) < messages % static_cast<std::size_t>(producers) ? 1 : 0);
+			for (uint64_t i = 0; i < count; ++i)
+				queue.enQueue(message(p, i));
+		});
+	}
+	consume(queue, messages, check);
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	for (auto& t : threads)
+		t.join();
+	if (check.errors != 0)
+		std::printf("  %zu messages out of order!\n", check.errors);
+	return static_cast<double>(messages) / seconds / 1e6;
+}
+
+template <typename Queue>
+void consumeOneByOne(Queue& queue, std::size_t messages, OrderCheck& check)
+{
+	for (std::size_t received = 0; received < messages; ++received)
+		check(queue.deQueue());
+}
+
+template <typename Queue>
+void consumeBatches(Queue& queue, std::size_t messages, OrderCheck& check)
+{
+	std::vector<uint64_t> batch;
+	batch.reserve(batchSize);
+	for (std::size_t received = 0; received < messages;)
+	{
+		batch.clear();
+		received += queue.drainTo(std::back_inserter(batch), batchSize);
+		for (uint64_t value : batch)
+			check(value);
+	}
+}
+
+}	// namespace
+
+int main(int argc, char* argv[])
+{
+	std::size_t messages = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 4000000;
+	int maxProducers = argc > 2 ? std::atoi(argv[2]) : 32;
+
+	std::printf("%-10s %18s %18s %18s\n", "producers", "BQ deQueue Mmsg/s", "BQ drainTo Mmsg/s", "Mailbox Mmsg/s");
+	for (int producers = 1; producers <= maxProducers; producers *= 2)
+	{
+		BlockingQueue<uint64_t> single;
+		double lockedOne = run(single, messages, producers, consumeOneByOne<BlockingQueue<uint64_t>>);
+		BlockingQueue<uint64_t> batched;
+		double lockedBatch = run(batched, messages, producers, consumeBatches<BlockingQueue<uint64_t>>);
+		MpscMailbox<uint64_t> mailbox;
+		double mailboxBatch = run(mailbox, messages, producers, consumeBatches<MpscMailbox<uint64_t>>);
+		std::printf("%-10d %18.2f %18.2f %18.2f\n", producers, lockedOne, lockedBatch, mailboxBatch);
+	}
+	return 0;
+}
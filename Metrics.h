@@ -0,0 +1,277 @@
+#pragma once
+
+/*
+Metrics: per-thread latency histograms and event counters for the schedulers and rate limiters
+
+Compiled in only with -DCONCURRENCY_METRICS=1. Without it every recording call is an empty inline
+function and snapshot() returns zeros, so instrumented code costs nothing.
+
+What is recorded (all durations in nanoseconds)
+•	Lateness:    how long after its due time a task was dispatched.
+•	Execution:   how long a task ran, for tasks a scheduler runs itself rather than handing to a pool.
+•	AcquireWait: how long RateLimiter::acquire() blocked its caller.
+•	QueueDepth:  pending tasks, sampled at every dispatch.
+•	Counters: Wakeups (scheduler thread woke from a wait) and SpuriousWakeups (it woke and found
+	nothing due, so it went straight back to sleep).
+
+Histograms are HDR-style (log-linear): values below 32 have their own bucket, above that every power
+of two is split into 32 buckets, so any recorded value is known to within about 3% over the whole
+64-bit range with a fixed 1920 buckets.
+
+Cost
+Each thread records into its own shard, allocated and registered on the thread's first event. A
+shard is written by its thread only, so an event is a few relaxed load/store pairs on cache lines no
+other thread writes: no atomic read-modify-write, no lock. snapshot() reads every shard with relaxed
+loads and merges them while the threads keep recording; a snapshot can therefore be off by the
+events that were in flight while it was taken. When a thread exits, its shard (about 61KB) is
+added into a "retired" accumulator that snapshot() counts as well, zeroed and kept for the next new
+thread, so counts from finished threads are kept and memory stays at one shard per live thread
+under thread churn. See MetricsBenchmark.cpp for the per-event cost.
+*/
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#ifndef CONCURRENCY_METRICS
+#define CONCURRENCY_METRICS 0
+#endif
+
+class Metrics {
+public:
+    enum Histogram { Lateness, Execution, AcquireWait, QueueDepth, kHistogramCount };
+    enum Counter { Wakeups, SpuriousWakeups, kCounterCount };
+
+    static constexpr bool kEnabled = CONCURRENCY_METRICS != 0;
+    static constexpr unsigned kSubBits = 5;
+    static constexpr uint64_t kSubBuckets = uint64_t{1} << kSubBits;
+    static constexpr std::size_t kBuckets = (64 - kSubBits + 1) * kSubBuckets;
+
+    struct HistogramSnapshot {
+        uint64_t count = 0;
+        uint64_t sum = 0;
+        uint64_t max = 0;
+        std::vector<uint64_t> buckets = std::vector<uint64_t>(kBuckets);
+
+        double mean() const { return count ? static_cast<double>(sum) / static_cast<double>(count) : 0.0; }
+
+        // Smallest recorded value v such that a fraction p (0..1) of the values are <= v, to within
+        // one bucket (about 3%)
+        uint64_t percentile(double p) const {
+            if (count == 0) return 0;
+            uint64_t rank = static_cast<uint64_t>(p * static_cast<double>(count - 1)) + 1;
+            uint64_t seen = 0;
+            for (std::size_t i = 0; i < kBuckets; ++i) {
+                seen += buckets[i];
+                if (seen >= rank) {
+                    uint64_t upper = bucketUpper(i);
+                    return upper < max ? upper : max;
+                }
+            }
+            return max;
+        }
+    };
+
+    struct Snapshot {
+        std::array<HistogramSnapshot, kHistogramCount> histograms;
+        std::array<uint64_t, kCounterCount> counters{};
+
+        const HistogramSnapshot& operator[](Histogram h) const { return histograms[h]; }
+        uint64_t operator[](Counter c) const { return counters[c]; }
+    };
+
+    static void record(Histogram h, uint64_t value) {
+        if constexpr (kEnabled) {
+            HistogramShard& hist = local().histograms[h];
+            bump(hist.buckets[bucketIndex(value)], 1);
+            bump(hist.count, 1);
+            bump(hist.sum, value);
+            if (value > hist.max.load(std::memory_order_relaxed)) {
+                hist.max.store(value, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Durations are recorded in nanoseconds; negative durations count as 0
+    template <typename Rep, typename Period>
+    static void record(Histogram h, std::chrono::duration<Rep, Period> d) {
+        if constexpr (kEnabled) {
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+            record(h, ns > 0 ? static_cast<uint64_t>(ns) : 0);
+        }
+    }
+
+    // Records the time from construction to destruction; does not even read the clock when compiled out
+    class ScopedTimer {
+    public:
+        explicit ScopedTimer(Histogram h) : histogram_(h) {
+            if constexpr (kEnabled) start_ = std::chrono::steady_clock::now();
+        }
+        ~ScopedTimer() {
+            if constexpr (kEnabled) record(histogram_, std::chrono::steady_clock::now() - start_);
+        }
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    private:
+        Histogram histogram_;
+        std::chrono::steady_clock::time_point start_;
+    };
+
+    static void count(Counter c, uint64_t n = 1) {
+        if constexpr (kEnabled) {
+            bump(local().counters[c], n);
+        }
+    }
+
+    // Merge every thread's shard; safe to call while other threads keep recording
+    static Snapshot snapshot() {
+        Snapshot result;
+        if constexpr (kEnabled) {
+            Registry& registry = instance();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            addInto(result, registry.retired);
+            for (const auto& shard : registry.shards) {
+                addInto(result, *shard);
+            }
+        }
+        return result;
+    }
+
+    static std::size_t bucketIndex(uint64_t value) {
+        if (value < kSubBuckets) {
+            return static_cast<std::size_t>(value);
+        }
+        unsigned exponent = 63 - static_cast<unsigned>(__builtin_clzll(value));
+        unsigned shift = exponent - kSubBits;
+        return static_cast<std::size_t>((shift + 1) * kSubBuckets + ((value >> shift) - kSubBuckets));
+    }
+
+    // Largest value that falls into bucket i
+    static uint64_t bucketUpper(std::size_t i) {
+        if (i < kSubBuckets) {
+            return i;
+        }
+        unsigned shift = static_cast<unsigned>(i / kSubBuckets) - 1;
+        uint64_t mantissa = i % kSubBuckets + kSubBuckets;
+        return ((mantissa + 1) << shift) - 1;
+    }
+
+private:
+    struct HistogramShard {
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> sum{0};
+        std::atomic<uint64_t> max{0};
+        std::atomic<uint64_t> buckets[kBuckets] = {};
+    };
+
+    struct alignas(64) Shard {
+        std::array<HistogramShard, kHistogramCount> histograms;
+        std::atomic<uint64_t> counters[kCounterCount] = {};
+    };
+
+    struct Registry {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<Shard>> shards; // One per thread that has recorded and not exited
+        std::vector<std::unique_ptr<Shard>> spare;  // Zeroed shards of exited threads, for new ones
+        Shard retired;                              // Sum of the shards of exited threads
+    };
+
+    static Registry& instance() {
+        static Registry registry;
+        return registry;
+    }
+
+    // Single writer: a plain load and store, not a locked add
+    static void bump(std::atomic<uint64_t>& counter, uint64_t n) {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    static void addInto(Snapshot& result, const Shard& shard) {
+        for (std::size_t h = 0; h < kHistogramCount; ++h) {
+            const HistogramShard& from = shard.histograms[h];
+            HistogramSnapshot& to = result.histograms[h];
+            to.count += from.count.load(std::memory_order_relaxed);
+            to.sum += from.sum.load(std::memory_order_relaxed);
+            uint64_t max = from.max.load(std::memory_order_relaxed);
+            if (max > to.max) to.max = max;
+            for (std::size_t i = 0; i < kBuckets; ++i) {
+                to.buckets[i] += from.buckets[i].load(std::memory_order_relaxed);
+            }
+        }
+        for (std::size_t c = 0; c < kCounterCount; ++c) {
+            result.counters[c] += shard.counters[c].load(std::memory_order_relaxed);
+        }
+    }
+
+    // Under the registry mutex: add `from` into `to` and zero it
+    static void moveInto(Shard& to, Shard& from) {
+        for (std::size_t h = 0; h < kHistogramCount; ++h) {
+            HistogramShard& source = from.histograms[h];
+            HistogramShard& target = to.histograms[h];
+            bump(target.count, source.count.exchange(0, std::memory_order_relaxed));
+            bump(target.sum, source.sum.exchange(0, std::memory_order_relaxed));
+            uint64_t max = source.max.exchange(0, std::memory_order_relaxed);
+            if (max > target.max.load(std::memory_order_relaxed)) target.max.store(max, std::memory_order_relaxed);
+            for (std::size_t i = 0; i < kBuckets; ++i) {
+                uint64_t n = source.buckets[i].exchange(0, std::memory_order_relaxed);
+                if (n) bump(target.buckets[i], n);
+            }
+        }
+        for (std::size_t c = 0; c < kCounterCount; ++c) {
+            bump(to.counters[c], from.counters[c].exchange(0, std::memory_order_relaxed));
+        }
+    }
+
+    static Shard& local() {
+        // The plain pointer keeps the per-event path free of the thread_local destructor's guard
+        thread_local Shard* shard = nullptr;
+        thread_local bool exited = false;
+        if (!shard) {
+            Registry& registry = instance();
+            {
+                std::lock_guard<std::mutex> lock(registry.mutex);
+                if (registry.spare.empty()) {
+                    registry.shards.push_back(std::make_unique<Shard>());
+                } else {
+                    registry.shards.push_back(std::move(registry.spare.back()));
+                    registry.spare.pop_back();
+                }
+                shard = registry.shards.back().get();
+            }
+            // Retire the shard when the thread exits. An event recorded from another thread_local's
+            // destructor after that gets a shard that is never retired.
+            if (!exited) {
+                struct Owner {
+                    ~Owner() {
+                        retire(shard);
+                        shard = nullptr;
+                        exited = true;
+                    }
+                };
+                thread_local Owner owner;
+                (void)owner;
+            }
+        }
+        return *shard;
+    }
+
+    // The thread that owns `shard` is exiting: fold it into the retired counts and keep it as a spare
+    static void retire(Shard* shard) {
+        Registry& registry = instance();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        for (auto it = registry.shards.begin(); it != registry.shards.end(); ++it) {
+            if (it->get() == shard) {
+                moveInto(registry.retired, *shard);
+                registry.spare.push_back(std::move(*it));
+                registry.shards.erase(it);
+                return;
+            }
+        }
+    }
+};
@@ -0,0 +1,86 @@
+/*
+Metrics cost per event
+
+Every thread records events in a tight loop while the main thread keeps taking snapshots, as a
+monitoring endpoint would:
+•	count:   Metrics::count(), a counter bump.
+•	record:  Metrics::record() of a precomputed value (lateness computed from a clock read the
+	scheduler already does).
+•	timer:   Metrics::ScopedTimer around an empty scope: two clock reads plus a record.
+•	clock:   a bare steady_clock::now(), for reference; timer costs two of these on top of record.
+The benchmark compiles Metrics in whatever the build flags say; without metrics it shows the cost of
+the empty loop.
+
+Usage: MetricsBenchmark [threads] [events per thread]   (default: hardware threads, 10000000)
+*/
+
+#ifndef CONCURRENCY_METRICS
+#define CONCURRENCY_METRICS 1
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include "Metrics.h"
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+template <typename Event>
+double nsPerEvent(unsigned threads, uint64_t events, Event event) {
+    std::atomic<unsigned> running{threads};
+    std::vector<std::thread> workers;
+    auto start = Clock::now();
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            for (uint64_t i = 0; i < events; ++i) {
+                event(i * (t + 1));
+            }
+            running.fetch_sub(1);
+        });
+    }
+    uint64_t snapshots = 0;
+    while (running.load() > 0) {
+        Metrics::snapshot();
+        ++snapshots;
+    }
+    for (auto& w : workers) w.join();
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    std::printf("  (%llu snapshots taken meanwhile)\n", static_cast<unsigned long long>(snapshots));
+    return ns / static_cast<double>(events); // Per thread: the threads run in parallel
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    unsigned threads = argc > 1 ? static_cast<unsigned>(std::atoi(argv[1])) : std::thread::hardware_concurrency();
+    if (threads == 0) threads = 1;
+    uint64_t events = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 10000000;
+
+    std::printf("metrics %s, %u threads, %llu events per thread\n", Metrics::kEnabled ? "enabled" : "compiled out",
+                threads, static_cast<unsigned long long>(events));
+    double count = nsPerEvent(threads, events, [](uint64_t) { Metrics::count(Metrics::Wakeups); });
+    double record = nsPerEvent(threads, events, [](uint64_t v) { Metrics::record(Metrics::Lateness, v & 0xfffff); });
+    double timer = nsPerEvent(threads, events, [](uint64_t) { Metrics::ScopedTimer timer(Metrics::Execution); });
+    std::atomic<int64_t> sink{0};
+    double clock = nsPerEvent(threads, events, [&sink](uint64_t) {
+        sink.store(Clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+    });
+    std::printf("%-8s %10s\n", "event", "ns/event");
+    std::printf("%-8s %10.2f\n", "count", count);
+    std::printf("%-8s %10.2f\n", "record", record);
+    std::printf("%-8s %10.2f\n", "timer", timer);
+    std::printf("%-8s %10.2f\n", "clock", clock);
+
+    auto snapshot = Metrics::snapshot();
+    std::printf("recorded %llu lateness values, p50 %llu, p99 %llu\n",
+                static_cast<unsigned long long>(snapshot[Metrics::Lateness].count),
+                static_cast<unsigned long long>(snapshot[Metrics::Lateness].percentile(0.5)),
+                static_cast<unsigned long long>(snapshot[Metrics::Lateness].percentile(0.99)));
+    return 0;
+}
@@ -0,0 +1,198 @@
+#pragma once
+
+/*
+MultiQueue: concurrent priority queue with relaxed ordering
+
+A std::priority_queue behind one mutex serializes every push. MultiQueue spreads the elements over
+c·P sub-heaps (P threads, c sub-heaps per thread), each with its own mutex and a cached copy of its
+smallest key that other threads read without locking:
+•	push: lock a random sub-heap (try_lock; on contention try another one) and push there. Threads
+	rarely meet on the same sub-heap, so pushes scale with the number of threads.
+•	tryPop: look at the cached keys of two random sub-heaps and pop from the smaller (the "power of
+	two choices"). The element popped is not always the global minimum: its expected rank error
+	(how many smaller elements remain) grows linearly with the number of sub-heaps, so c is the
+	knob between ordering (c = 1) and contention (larger c). Two choices keep the error bounded;
+	one random choice would let it grow without bound.
+•	tryPopMin / tryPopMinIf: scan every cached key and pop from the smallest. O(c·P) loads instead of
+	two, but the only error left is from pushes racing with the scan. Meant for a single consumer,
+	e.g. a scheduler's worker, which must not sleep while a due element is hidden in another heap.
+•	minKey: the smallest cached key, same scan.
+
+Elements with the same key come out in no particular order. empty() and size() are exact only when
+no other thread is operating on the queue. Scheduler::Backend::MultiQueue uses it as its task store.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+template <typename Key, typename Value, typename Compare = std::less<Key>>
+class MultiQueue {
+public:
+    // threads: how many threads are expected to use the queue at once (P);
+    // queuesPerThread: sub-heaps per thread (c), which trades rank error for contention
+    explicit MultiQueue(std::size_t threads = std::thread::hardware_concurrency(), std::size_t queuesPerThread = 2)
+        : count_(std::max<std::size_t>(2, std::max<std::size_t>(threads, 1) * std::max<std::size_t>(queuesPerThread, 1))),
+          queues_(std::make_unique<SubQueue[]>(count_)) {}
+
+    MultiQueue(const MultiQueue&) = delete;
+    MultiQueue& operator=(const MultiQueue&) = delete;
+
+    void push(Key key, Value value) {
+        std::size_t index = pick();
+        std::unique_lock<std::mutex> lock(queues_[index].mutex, std::try_to_lock);
+        for (std::size_t tries = 1; !lock.owns_lock(); ++tries) {
+            index = pick();
+            if (tries < count_) {
+                lock = std::unique_lock<std::mutex>(queues_[index].mutex, std::try_to_lock);
+            } else {
+                lock = std::unique_lock<std::mutex>(queues_[index].mutex); // Everything busy: wait for one
+            }
+        }
+        SubQueue& queue = queues_[index];
+        queue.heap.emplace_back(std::move(key), std::move(value));
+        std::push_heap(queue.heap.begin(), queue.heap.end(), EntryCompare());
+        queue.publish();
+    }
+
+    // Pop an element close to the minimum (two random choices); false if the queue looks empty
+    bool tryPop(Key& key, Value& value) {
+        return tryPopIf([](const Key&, const Value&) { return true; }, key, value);
+    }
+
+    // Same, but only pop it if pred(key, value) holds for the element that would be popped
+    template <typename Pred>
+    bool tryPopIf(Pred pred, Key& key, Value& value) {
+        for (int attempt = 0; attempt < 4; ++attempt) {
+            std::size_t a = pick();
+            std::size_t b = pick();
+            std::size_t index = better(a, b) ? a : b;
+            if (queues_[index].size.load(std::memory_order_acquire) == 0) {
+                break; // Both look empty: fall back to the scan
+            }
+            std::unique_lock<std::mutex> lock(queues_[index].mutex, std::try_to_lock);
+            if (lock.owns_lock() && !queues_[index].heap.empty()) {
+                return popLocked(queues_[index], pred, key, value);
+            }
+        }
+        return tryPopMinIf(pred, key, value);
+    }
+
+    // Pop from the sub-heap whose cached minimum is the smallest; false if the queue looks empty
+    bool tryPopMin(Key& key, Value& value) {
+        return tryPopMinIf([](const Key&, const Value&) { return true; }, key, value);
+    }
+
+    // Same, but only pop it if pred(key, value) holds for the element that would be popped
+    template <typename Pred>
+    bool tryPopMinIf(Pred pred, Key& key, Value& value) {
+        while (true) {
+            std::optional<std::size_t> index = smallest();
+            if (!index) {
+                return false;
+            }
+            std::lock_guard<std::mutex> lock(queues_[*index].mutex);
+            if (!queues_[*index].heap.empty()) {
+                return popLocked(queues_[*index], pred, key, value);
+            }
+            // Emptied between the scan and the lock: scan again
+        }
+    }
+
+    // The smallest key, or nullopt if the queue looks empty
+    std::optional<Key> minKey() const {
+        std::optional<std::size_t> index = smallest();
+        if (!index) {
+            return std::nullopt;
+        }
+        return queues_[*index].top.load(std::memory_order_acquire);
+    }
+
+    bool empty() const { return size() == 0; }
+
+    std::size_t size() const {
+        std::size_t total = 0;
+        for (std::size_t i = 0; i < count_; ++i) {
+            total += queues_[i].size.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    std::size_t subQueues() const { return count_; }
+
+private:
+    struct Entry {
+        Key key;
+        Value value;
+    };
+    struct EntryCompare {
+        bool operator()(const Entry& a, const Entry& b) const { return Compare()(b.key, a.key); }
+    };
+
+    struct alignas(64) SubQueue {
+        std::mutex mutex;
+        std::vector<Entry> heap;   // Min-heap by key, under mutex
+        std::atomic<Key> top{};    // heap.front().key, readable without the mutex; stale when size is 0
+        std::atomic<std::size_t> size{0};
+
+        // Under mutex, after every change. A caller that must not miss a concurrent push (Scheduler's
+        // worker) pairs seq_cst fences around its own store and the scan.
+        void publish() {
+            if (!heap.empty()) {
+                top.store(heap.front().key, std::memory_order_release);
+            }
+            size.store(heap.size(), std::memory_order_release);
+        }
+    };
+
+    const std::size_t count_;
+    std::unique_ptr<SubQueue[]> queues_;
+
+    // A random sub-heap: xorshift and a multiply instead of std::minstd_rand and %, which both divide
+    std::size_t pick() const {
+        thread_local uint64_t state = std::hash<std::thread::id>()(std::this_thread::get_id()) | 1;
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return static_cast<std::size_t>(((state >> 32) * count_) >> 32);
+    }
+
+    // Whether sub-heap a looks like the better one to pop from
+    bool better(std::size_t a, std::size_t b) const {
+        if (queues_[b].size.load(std::memory_order_acquire) == 0) return true;
+        if (queues_[a].size.load(std::memory_order_acquire) == 0) return false;
+        return !Compare()(queues_[b].top.load(std::memory_order_acquire), queues_[a].top.load(std::memory_order_acquire));
+    }
+
+    std::optional<std::size_t> smallest() const {
+        std::optional<std::size_t> best;
+        for (std::size_t i = 0; i < count_; ++i) {
+            if (queues_[i].size.load(std::memory_order_acquire) != 0 && (!best || better(i, *best))) {
+                best = i;
+            }
+        }
+        return best;
+    }
+
+    template <typename Pred>
+    static bool popLocked(SubQueue& queue, Pred& pred, Key& key, Value& value) {
+        Entry& front = queue.heap.front();
+        if (!pred(static_cast<const Key&>(front.key), static_cast<const Value&>(front.value))) {
+            return false;
+        }
+        std::pop_heap(queue.heap.begin(), queue.heap.end(), EntryCompare());
+        key = std::move(queue.heap.back().key);
+        value = std::move(queue.heap.back().value);
+        queue.heap.pop_back();
+        queue.publish();
+        return true;
+    }
+};
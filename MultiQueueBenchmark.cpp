@@ -0,0 +1,144 @@
+/*
+MultiQueue: schedule() throughput from many threads, and the rank error of relaxed pops
+
+•	schedule: P threads call Scheduler::schedule() N/P times each, with delays spread over 50ms, on
+	the Heap backend (one heap behind the scheduler's mutex) and on the MultiQueue backend.
+	Reports millions of schedule() calls per second, measured over the producers only; the
+	destructor then runs every task.
+•	rank error: N distinct random keys are pushed into a MultiQueue sized for 8 threads with c
+	sub-heaps per thread, then popped one by one with tryPop (two random choices) and with
+	tryPopMin (scan). The rank error of a pop is how many smaller keys were still in the queue.
+
+Usage: MultiQueueBenchmark [schedules] [max producers] [keys]   (default: 1000000 32 100000)
+---
+Output on a single-core machine (numbers vary by machine):
+producers       Heap Mops/s MultiQueue Mops/s
+1                      4.19             3.43
+2                      4.89             3.82
+4                      5.24             4.65
+8                      5.70             4.23
+16                     4.83             4.85
+32                     6.37             5.47
+pop             c  sub-heaps   mean error  max error
+tryPop          1          8         5.74         80
+tryPop          2         16        12.53        216
+tryPop          4         32        25.33        321
+tryPopMin       2         16         0.00          0
+With one core only one producer runs at a time, so the heap's mutex is never contended and the
+MultiQueue only shows its extra cost (a random pick, the cached keys, a fence). Its point is the
+case this machine cannot show: producers on different cores pushing into different sub-heaps.
+The mean rank error doubles with c, as expected.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <vector>
+#include "MultiQueue.h"
+#include "Scheduler.h"
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+std::atomic<uint64_t> ran{0};
+
+double scheduleRate(Scheduler::Backend backend, std::size_t schedules, int producers) {
+    ran = 0;
+    double seconds;
+    {
+        Scheduler scheduler(backend);
+        std::atomic<bool> go{false};
+        std::vector<std::thread> threads;
+        for (int p = 0; p < producers; ++p) {
+            threads.emplace_back([&, p] {
+                std::size_t count = schedules / static_cast<std::size_t>(producers);
+                std::minstd_rand rng(static_cast<unsigned>(p + 1));
+                while (!go.load(std::memory_order_acquire)) {
+                    std::this_thread::yield();
+                }
+                for (std::size_t i = 0; i < count; ++i) {
+                    scheduler.schedule([] { ran.fetch_add(1, std::memory_order_relaxed); },
+                                       std::chrono::microseconds(50000 + rng() % 50000));
+                }
+            });
+        }
+        auto start = Clock::now();
+        go.store(true, std::memory_order_release);
+        for (auto& t : threads) t.join();
+        seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    } // Runs every task
+    std::size_t expected = schedules / static_cast<std::size_t>(producers) * static_cast<std::size_t>(producers);
+    if (ran.load() != expected) {
+        std::printf("  only %llu of %zu tasks ran!\n", static_cast<unsigned long long>(ran.load()), expected);
+    }
+    return static_cast<double>(expected) / seconds / 1e6;
+}
+
+// Fenwick tree over the keys still in the queue, to count the smaller ones
+struct Remaining {
+    std::vector<int> tree;
+
+    explicit Remaining(std::size_t n) : tree(n + 1, 0) {
+        for (std::size_t i = 1; i <= n; ++i) {
+            tree[i] += 1;
+            std::size_t parent = i + (i & (~i + 1));
+            if (parent <= n) tree[parent] += tree[i];
+        }
+    }
+    void remove(std::size_t key) {
+        for (std::size_t i = key + 1; i < tree.size(); i += i & (~i + 1)) tree[i] -= 1;
+    }
+    std::size_t smaller(std::size_t key) const { // Keys < key still present
+        std::size_t total = 0;
+        for (std::size_t i = key; i > 0; i -= i & (~i + 1)) total += static_cast<std::size_t>(tree[i]);
+        return total;
+    }
+};
+
+void rankError(std::size_t keys, std::size_t queuesPerThread, bool scan) {
+    MultiQueue<uint32_t, uint32_t> queue(8, queuesPerThread);
+    std::vector<uint32_t> order(keys);
+    std::iota(order.begin(), order.end(), 0u);
+    std::shuffle(order.begin(), order.end(), std::mt19937(42));
+    for (uint32_t key : order) queue.push(key, key);
+
+    Remaining remaining(keys);
+    double total = 0;
+    std::size_t worst = 0;
+    uint32_t key, value;
+    while (scan ? queue.tryPopMin(key, value) : queue.tryPop(key, value)) {
+        std::size_t error = remaining.smaller(key);
+        remaining.remove(key);
+        total += static_cast<double>(error);
+        worst = std::max(worst, error);
+    }
+    std::printf("%-10s %6zu %10zu %12.2f %10zu\n", scan ? "tryPopMin" : "tryPop", queuesPerThread,
+                queue.subQueues(), total / static_cast<double>(keys), worst);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::size_t schedules = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    int maxProducers = argc > 2 ? std::atoi(argv[2]) : 32;
+    std::size_t keys = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 100000;
+
+    std::printf("%-10s %16s %16s\n", "producers", "Heap Mops/s", "MultiQueue Mops/s");
+    for (int producers = 1; producers <= maxProducers; producers *= 2) {
+        double heap = scheduleRate(Scheduler::Backend::Heap, schedules, producers);
+        double multi = scheduleRate(Scheduler::Backend::MultiQueue, schedules, producers);
+        std::printf("%-10d %16.2f %16.2f\n", producers, heap, multi);
+    }
+
+    std::printf("%-10s %6s %10s %12s %10s\n", "pop", "c", "sub-heaps", "mean error", "max error");
+    for (std::size_t c : {1, 2, 4}) rankError(keys, c, false);
+    rankError(keys, 2, true);
+    return 0;
+}
@@ -0,0 +1,151 @@
+/*
+Periodic timer benchmark
+
+N periodic timers (periods between 10ms and 100ms) run for a simulated 10 seconds. Every run is
+dispatched a little late (0-500us, as a busy scheduler thread would), which is where drift comes from:
+•	callback: the old pattern, a one-shot task that schedules a fresh copy of itself "period from now"
+	when it runs. Each tick pops the task, builds a new std::function and pushes it again.
+•	rearm: what AtomicTaskScheduler::schedulePeriodic does, TimerQueue::detachDue followed by rearm at
+	due + period. The task stays in its slot.
+
+Reports ns and heap allocations (AllocationCounter.h) per tick, and the mean drift: how far each
+timer's last due time has slipped from its ideal grid first + k * period.
+
+Usage: PeriodicTimerBenchmark [timers]   (default: 200000)
+*/
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <vector>
+#include "AllocationCounter.h"
+#include "TimerQueue.h"
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+constexpr auto kDuration = std::chrono::seconds(10);
+
+struct Result {
+    double nsPerTick;
+    double allocsPerTick;
+    double driftMs;
+    std::size_t ticks;
+};
+
+struct Timer {
+    Clock::duration period;
+    Clock::time_point first;
+    Clock::time_point lastDue;
+    uint64_t runs = 0;
+};
+
+// Payload the callbacks capture, so they are too big for std::function's inline storage
+using Payload = std::array<uint64_t, 4>;
+
+double meanDriftMs(const std::vector<Timer>& timers) {
+    double total = 0;
+    for (const Timer& t : timers) {
+        auto ideal = t.first + t.period * (t.runs - 1);
+        total += std::chrono::duration<double, std::milli>(t.lastDue - ideal).count();
+    }
+    return total / static_cast<double>(timers.size());
+}
+
+// Started after the timers are armed, so only the ticks are measured
+struct Probe {
+    uint64_t allocs = allocationCount();
+    Clock::time_point start = Clock::now();
+
+    Result finish(std::size_t ticks, const std::vector<Timer>& timers) const {
+        auto elapsed = Clock::now() - start;
+        double allocated = static_cast<double>(allocationCount() - allocs);
+        return {std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(ticks),
+                allocated / static_cast<double>(ticks), meanDriftMs(timers), ticks};
+    }
+};
+
+void print(const char* name, const Result& r) {
+    std::printf("%-9s %12zu %10.1f %12.3f %10.3f\n", name, r.ticks, r.nsPerTick, r.allocsPerTick, r.driftMs);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+
+    std::mt19937_64 rng(7);
+    auto base = Clock::time_point{};
+    std::vector<Timer> timers(count);
+    for (Timer& t : timers) {
+        t.period = std::chrono::milliseconds(10 + rng() % 91);
+        t.first = base + t.period;
+    }
+    auto end = base + kDuration;
+
+    std::printf("%zu periodic timers, %lld simulated seconds\n", count,
+                static_cast<long long>(std::chrono::duration_cast<std::chrono::seconds>(kDuration).count()));
+    std::printf("%-9s %12s %10s %12s %10s\n", "pattern", "ticks", "ns/tick", "allocs/tick", "drift ms");
+
+    // A one-shot task that re-schedules a fresh copy of itself from inside its callback
+    std::vector<Timer> callbackTimers = timers;
+    print("callback", [&]() {
+        using Timers = TimerQueue<std::function<void(Clock::time_point, Clock::time_point)>>;
+        Timers queue;
+        std::function<void(std::size_t, Clock::time_point)> arm = [&](std::size_t i, Clock::time_point when) {
+            Payload payload{i};
+            queue.add(when, [&, payload](Clock::time_point due, Clock::time_point now) {
+                Timer& t = callbackTimers[payload[0]];
+                t.lastDue = due;
+                ++t.runs;
+                arm(payload[0], now + t.period); // "period from now": every late dispatch adds up
+            });
+        };
+        for (std::size_t i = 0; i < count; ++i) arm(i, callbackTimers[i].first);
+
+        std::mt19937_64 lateness(11);
+        std::size_t ticks = 0;
+        std::function<void(Clock::time_point, Clock::time_point)> task;
+        Probe probe;
+        while (!queue.empty() && queue.nextTime() <= end) {
+            auto due = queue.nextTime();
+            queue.popDue(due, task);
+            task(due, due + std::chrono::microseconds(lateness() % 500));
+            ++ticks;
+        }
+        return probe.finish(ticks, callbackTimers);
+    }());
+
+    // Stored once and re-armed in place on the period grid; the callback returns its next due time
+    std::vector<Timer> rearmTimers = timers;
+    print("rearm", [&]() {
+        using Timers = TimerQueue<std::function<Clock::time_point(Clock::time_point)>>;
+        Timers queue;
+        for (std::size_t i = 0; i < count; ++i) {
+            Payload payload{i};
+            queue.add(rearmTimers[i].first, [&rearmTimers, payload](Clock::time_point due) {
+                Timer& t = rearmTimers[payload[0]];
+                t.lastDue = due;
+                ++t.runs;
+                return due + t.period;
+            });
+        }
+
+        std::size_t ticks = 0;
+        Timers::TimerId id;
+        Probe probe;
+        while (!queue.empty() && queue.nextTime() <= end) {
+            auto due = queue.nextTime();
+            queue.detachDue(due, id);
+            queue.rearm(id, queue.task(id)(due));
+            ++ticks;
+        }
+        return probe.finish(ticks, rearmTimers);
+    }());
+    return 0;
+}
@@ -0,0 +1,202 @@
+/*
+Handing queue messages to an event loop: helper thread vs pollable BlockingQueue
+
+An EpollReactor thread (EventBasedConcurrency/EpollReactor.h) has to consume messages that other
+threads put into a BlockingQueue. Two ways to connect them:
+•	helper: a dedicated thread blocks in drainTo() and post()s each message to the reactor, which
+	wakes through its own eventfd. Every message crosses two threads before it is handled.
+•	pollable: the queue's pollFd() is registered with the reactor, whose handler drains the queue with
+	tryDeQueueBatch(). No helper thread.
+
+Two tests per mode:
+•	rtt: one message at a time; the loop answers through a second BlockingQueue the sender blocks on.
+	ns/msg is the round-trip time.
+•	stream: the sender pushes N messages as fast as it can; ns/msg is the elapsed time per message.
+Both report context switches per message (voluntary + involuntary, whole process, from getrusage).
+
+Usage: PollableQueueBenchmark [messages]   (default: 200000; rtt uses a tenth)
+---
+Output on a single-core machine (numbers vary by machine):
+mode       test          msgs      ns/msg   ctxsw/msg
+helper     rtt          20000      5305.6       3.751
+pollable   rtt          20000      3077.3       2.000
+helper     stream      200000       155.8       0.050
+pollable   stream      200000        42.8       0.018
+*/
+
+#include <sys/epoll.h>
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include "BlockingQueue.cpp"
+#include "EventBasedConcurrency/EpollReactor.h"
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+constexpr std::size_t kBatch = 64;
+
+uint64_t contextSwitches()
+{
+	rusage usage{};
+	getrusage(RUSAGE_SELF, &usage);
+	return static_cast<uint64_t>(usage.ru_nvcsw + usage.ru_nivcsw);
+}
+
+// The consumer side of each mode connects `input` to the reactor and calls handle(message) on the
+// loop thread; stop() is called once the last message has been handled
+template <typename Handle>
+struct HelperPipeline
+{
+	BlockingQueue<uint64_t>& input;
+	EpollReactor& reactor;
+	std::thread helper;
+
+	HelperPipeline(BlockingQueue<uint64_t>& in, EpollReactor& r, Handle handle) : input(in), reactor(r)
+	{
+		helper = std::thread([this, handle]() {
+			std::vector<uint64_t> batch(kBatch);
+			while (true)
+			{
+				std::size_t n = input.drainTo(batch.begin(), kBatch);
+				bool last = false;
+				for (std::size_t i = 0; i < n; ++i)
+				{
+					uint64_t message = batch[i];
+					last |= message == 0;
+					reactor.post([handle, message]() mutable { handle(message); });
+				}
+				if (last)
+					return;
+			}
+		});
+	}
+
+	void stop()
+	{
+		input.enQueue(0);	// Sentinel; the handler ignores it
+		helper.join();
+	}
+};
+
+template <typename Handle>
+struct PollablePipeline
+{
+	BlockingQueue<uint64_t>& input;
+	std::vector<uint64_t> batch;
+
+	PollablePipeline(BlockingQueue<uint64_t>& in, EpollReactor& reactor, Handle handle) : input(in)
+	{
+		batch.reserve(kBatch);
+		reactor.add(input.pollFd(), EPOLLIN, [this, handle](uint32_t) mutable {
+			while (input.tryDeQueueBatch(batch, kBatch) > 0)
+			{
+				for (uint64_t message : batch)
+					handle(message);
+				if (batch.size() < kBatch)
+					break;
+			}
+		});
+	}
+
+	void stop()
+	{
+	}
+};
+
+struct Result
+{
+	std::size_t messages;
+	double nsPerMessage;
+	double switchesPerMessage;
+};
+
+template <template <typename> class Mode>
+Result rtt(std::size_t messages)
+{
+	EpollReactor reactor;
+	BlockingQueue<uint64_t> input;
+	BlockingQueue<uint64_t> replies;
+	auto handle = [&replies](uint64_t message) {
+		if (message != 0)
+			replies.enQueue(message);
+	};
+	Mode<decltype(handle)> pipeline(input, reactor, handle);
+	std::thread loop([&reactor]() { reactor.run(); });
+
+	for (uint64_t i = 1; i <= 100; ++i)	// Warm-up
+	{
+		input.enQueue(i);
+		replies.deQueue();
+	}
+	uint64_t switches = contextSwitches();
+	auto start = Clock::now();
+	for (uint64_t i = 1; i <= messages; ++i)
+	{
+		input.enQueue(i);
+		if (replies.deQueue() != i)
+			std::abort();
+	}
+	std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+	switches = contextSwitches() - switches;
+
+	pipeline.stop();
+	reactor.stop();
+	loop.join();
+	return { messages, elapsed.count() / static_cast<double>(messages), static_cast<double>(switches) / static_cast<double>(messages) };
+}
+
+template <template <typename> class Mode>
+Result stream(std::size_t messages)
+{
+	EpollReactor reactor;
+	BlockingQueue<uint64_t> input;
+	BlockingQueue<uint64_t> done;
+	uint64_t received = 0;
+	auto handle = [&received, &done, messages](uint64_t message) {
+		if (message != 0 && ++received == messages)
+			done.enQueue(received);
+	};
+	Mode<decltype(handle)> pipeline(input, reactor, handle);
+	std::thread loop([&reactor]() { reactor.run(); });
+
+	uint64_t switches = contextSwitches();
+	auto start = Clock::now();
+	for (uint64_t i = 1; i <= messages; ++i)
+		input.enQueue(i);
+	done.deQueue();
+	std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+	switches = contextSwitches() - switches;
+
+	pipeline.stop();
+	reactor.stop();
+	loop.join();
+	return { messages, elapsed.count() / static_cast<double>(messages), static_cast<double>(switches) / static_cast<double>(messages) };
+}
+
+void print(const char* mode, const char* test, const Result& r)
+{
+	std::printf("%-10s %-8s %9zu %11.1f %11.3f\n", mode, test, r.messages, r.nsPerMessage, r.switchesPerMessage);
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+	std::size_t messages = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+	std::size_t rounds = std::max<std::size_t>(messages / 10, 1);
+
+	std::printf("%-10s %-8s %9s %11s %11s\n", "mode", "test", "msgs", "ns/msg", "ctxsw/msg");
+	print("helper", "rtt", rtt<HelperPipeline>(rounds));
+	print("pollable", "rtt", rtt<PollablePipeline>(rounds));
+	print("helper", "stream", stream<HelperPipeline>(messages));
+	print("pollable", "stream", stream<PollablePipeline>(messages));
+	return 0;
+}
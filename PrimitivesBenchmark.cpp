@@ -0,0 +1,398 @@
+/*
+Microbenchmark suite for the primitives in this repository, with machine-readable results
+
+Groups (each result is named group/variant[/parameters]):
+•	lc1114/<approach>: the Foo classes of LC1114.cpp. Three threads run first/second/third on a
+	fresh Foo per round.
+	round_trip_ns: one round first -> second -> third, the next round starting only once the last
+	one finished (two handoffs plus the signal back to the first thread).
+	rounds_per_sec: the same rounds pipelined, every thread running ahead as far as Foo lets it.
+•	lc1115/<approach>: the FooBar classes of LC1115.cpp, foo() and bar() on two threads.
+	handoff_ns is the time per foo/bar switch; pairs_per_sec the "foobar" pairs printed per second.
+•	blocking_queue/<mutex|batch|lockfree>/p<P>c<C>: BlockingQueue (one element per call, or 64 per
+	lock with enQueueBulk/drainTo) and LockFreeBlockingQueue with P producers and C consumers.
+	Reports msgs_per_sec and the p50/p99 push-to-pop latency.
+•	scheduler/<heap|wheel>, atomic_task_scheduler/<inline|pool>: N tasks scheduled to run now.
+	schedule_ns is the caller's cost per schedule() call, dispatch_per_sec how fast the tasks ran.
+•	rate_limiter/<lockfree|sharded>, keyed_rate_limiter, work_stealing_pool: cost per call on one
+	thread (ns_per_op), or tasks per second through the pool.
+
+Spinning approaches (lc1114/atomic_spin) burn a whole scheduler time slice per handoff when there are
+fewer cores than threads, so on such machines they run 1/100 of the rounds; every result records
+the iteration count it actually used.
+
+Output: a table on stderr, and JSON on stdout or in the file given with --json:
+{
+  "context": { "hardware_concurrency": 8, "scale": 1, "compiler": "..." },
+  "benchmarks": [ { "name": "lc1114/mutex_cv", "iterations": 20000, "round_trip_ns": 9120.5, ... }, ... ]
+}
+
+Usage: PrimitivesBenchmark [--json FILE] [--scale X] [--threads N] [--filter TEXT]
+	--scale   multiplies every iteration count (default 1)
+	--threads largest producer/consumer count for blocking_queue (default max(4, hardware threads))
+	--filter  only run benchmarks whose name contains TEXT
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "AtomicTaskScheduler.h"
+#include "BlockingQueue.cpp"
+#include "KeyedRateLimiter.h"
+#include "LC1114.cpp"
+#include "LC1115.cpp"
+#include "LockFreeRateLimiter.h"
+#include "Scheduler.h"
+#include "WorkStealingPool.h"
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct Options {
+    const char* jsonPath = nullptr;
+    double scale = 1.0;
+    int maxThreads = 4;
+    const char* filter = "";
+};
+
+struct Record {
+    std::string name;
+    uint64_t iterations;
+    std::vector<std::pair<const char*, double>> values;
+};
+
+class Report {
+public:
+    explicit Report(const Options& options) : options_(options) {}
+
+    bool wants(const std::string& name) const { return name.find(options_.filter) != std::string::npos; }
+
+    std::size_t count(std::size_t base) const {
+        return std::max<std::size_t>(1, static_cast<std::size_t>(static_cast<double>(base) * options_.scale));
+    }
+
+    void add(Record record) {
+        std::fprintf(stderr, "%-36s %10llu", record.name.c_str(), static_cast<unsigned long long>(record.iterations));
+        for (const auto& [key, value] : record.values) {
+            std::fprintf(stderr, "  %s=%.4g", key, value);
+        }
+        std::fprintf(stderr, "\n");
+        records_.push_back(std::move(record));
+    }
+
+    void write(std::FILE* out) const {
+        std::fprintf(out, "{\n  \"context\": { \"hardware_concurrency\": %u, \"scale\": %g, \"compiler\": \"%s\" },\n",
+                     std::thread::hardware_concurrency(), options_.scale, __VERSION__);
+        std::fprintf(out, "  \"benchmarks\": [\n");
+        for (std::size_t i = 0; i < records_.size(); ++i) {
+            const Record& r = records_[i];
+            std::fprintf(out, "    { \"name\": \"%s\", \"iterations\": %llu", r.name.c_str(),
+                         static_cast<unsigned long long>(r.iterations));
+            for (const auto& [key, value] : r.values) {
+                std::fprintf(out, ", \"%s\": %.9g", key, value);
+            }
+            std::fprintf(out, " }%s\n", i + 1 < records_.size() ? "," : "");
+        }
+        std::fprintf(out, "  ]\n}\n");
+    }
+
+private:
+    const Options& options_;
+    std::vector<Record> records_;
+};
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+uint64_t nowNs() {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count());
+}
+
+bool fewCores(unsigned threads) {
+    return std::thread::hardware_concurrency() < threads;
+}
+
+// ---- LC1114 / LC1115 ----
+
+// Runs `rounds` rounds on fresh Foo objects; when `lockstep`, round r + 1 starts after round r ends
+template <typename Foo>
+double runFooRounds(std::size_t rounds, bool lockstep) {
+    std::unique_ptr<Foo[]> foos(new Foo[rounds]);
+    std::function<void()> noop = []() {};
+    std::atomic<std::size_t> finished{0};
+
+    auto start = Clock::now();
+    std::thread a([&]() {
+        for (std::size_t r = 0; r < rounds; ++r) {
+            while (lockstep && finished.load(std::memory_order_acquire) < r) std::this_thread::yield();
+            foos[r].first(noop);
+        }
+    });
+    std::thread b([&]() {
+        for (std::size_t r = 0; r < rounds; ++r) foos[r].second(noop);
+    });
+    std::thread c([&]() {
+        for (std::size_t r = 0; r < rounds; ++r) {
+            foos[r].third(noop);
+            finished.store(r + 1, std::memory_order_release);
+        }
+    });
+    a.join();
+    b.join();
+    c.join();
+    return secondsSince(start);
+}
+
+template <typename Foo>
+void benchFoo(Report& report, const char* approach, bool spins) {
+    std::string name = std::string("lc1114/") + approach;
+    if (!report.wants(name)) return;
+    std::size_t rounds = report.count(20000);
+    if (spins && fewCores(3)) rounds = std::max<std::size_t>(rounds / 100, 10);
+
+    double lockstep = runFooRounds<Foo>(rounds, true);
+    double pipelined = runFooRounds<Foo>(rounds, false);
+    report.add({name, rounds,
+                {{"round_trip_ns", lockstep * 1e9 / static_cast<double>(rounds)},
+                 {"rounds_per_sec", static_cast<double>(rounds) / pipelined}}});
+}
+
+template <typename FooBar>
+void benchFooBar(Report& report, const char* approach) {
+    std::string name = std::string("lc1115/") + approach;
+    if (!report.wants(name)) return;
+    int n = static_cast<int>(report.count(100000));
+
+    FooBar fooBar(n);
+    std::function<void()> noop = []() {};
+    auto start = Clock::now();
+    std::thread foo([&]() { fooBar.foo(noop); });
+    std::thread bar([&]() { fooBar.bar(noop); });
+    foo.join();
+    bar.join();
+    double seconds = secondsSince(start);
+    report.add({name, static_cast<uint64_t>(n),
+                {{"handoff_ns", seconds * 1e9 / (2.0 * n)}, {"pairs_per_sec", n / seconds}}});
+}
+
+// ---- BlockingQueue ----
+
+struct QueueResult {
+    double messagesPerSec;
+    uint64_t p50;
+    uint64_t p99;
+};
+
+QueueResult summarize(std::vector<std::vector<uint64_t>>& latencies, double seconds) {
+    std::vector<uint64_t> all;
+    for (auto& l : latencies) all.insert(all.end(), l.begin(), l.end());
+    std::sort(all.begin(), all.end());
+    auto pct = [&all](double q) {
+        return all[std::min(all.size() - 1, static_cast<std::size_t>(q * static_cast<double>(all.size())))];
+    };
+    return {static_cast<double>(all.size()) / seconds, pct(0.50), pct(0.99)};
+}
+
+// P producers push timestamps, C consumers pop them; `batch` > 1 uses enQueueBulk / drainTo
+template <typename Queue>
+QueueResult runQueue(Queue& queue, int producers, int consumers, std::size_t perProducer, std::size_t batch) {
+    std::size_t perConsumer = perProducer * static_cast<std::size_t>(producers) / static_cast<std::size_t>(consumers);
+    std::vector<std::vector<uint64_t>> latencies(static_cast<std::size_t>(consumers));
+    std::vector<std::thread> threads;
+
+    auto start = Clock::now();
+    for (int c = 0; c < consumers; ++c) {
+        threads.emplace_back([&queue, &latencies, c, perConsumer, batch]() {
+            auto& mine = latencies[static_cast<std::size_t>(c)];
+            mine.reserve(perConsumer);
+            if constexpr (std::is_same_v<Queue, BlockingQueue<uint64_t>>) {
+                if (batch > 1) {
+                    std::vector<uint64_t> stamps(batch);
+                    while (mine.size() < perConsumer) {
+                        std::size_t n = queue.drainTo(stamps.begin(), std::min(batch, perConsumer - mine.size()));
+                        uint64_t now = nowNs();
+                        for (std::size_t i = 0; i < n; ++i) mine.push_back(now - stamps[i]);
+                    }
+                    return;
+                }
+            }
+            for (std::size_t i = 0; i < perConsumer; ++i) {
+                uint64_t stamp = queue.deQueue();
+                mine.push_back(nowNs() - stamp);
+            }
+        });
+    }
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&queue, perProducer, batch]() {
+            if constexpr (std::is_same_v<Queue, BlockingQueue<uint64_t>>) {
+                if (batch > 1) {
+                    std::vector<uint64_t> stamps;
+                    for (std::size_t sent = 0; sent < perProducer; sent += stamps.size()) {
+                        stamps.assign(std::min(batch, perProducer - sent), nowNs());
+                        queue.enQueueBulk(stamps.begin(), stamps.end());
+                    }
+                    return;
+                }
+            }
+            for (std::size_t i = 0; i < perProducer; ++i) queue.enQueue(nowNs());
+        });
+    }
+    for (auto& t : threads) t.join();
+    return summarize(latencies, secondsSince(start));
+}
+
+void benchQueues(Report& report, int maxThreads) {
+    for (int n = 1; n <= maxThreads; n *= 2) {
+        std::size_t perProducer = report.count(200000) / static_cast<std::size_t>(n);
+        std::string suffix = "/p" + std::to_string(n) + "c" + std::to_string(n);
+        auto add = [&](const char* variant, const QueueResult& r) {
+            report.add({std::string("blocking_queue/") + variant + suffix, perProducer * static_cast<std::size_t>(n),
+                        {{"msgs_per_sec", r.messagesPerSec},
+                         {"p50_ns", static_cast<double>(r.p50)},
+                         {"p99_ns", static_cast<double>(r.p99)}}});
+        };
+        if (report.wants("blocking_queue/mutex" + suffix)) {
+            BlockingQueue<uint64_t> queue;
+            add("mutex", runQueue(queue, n, n, perProducer, 1));
+        }
+        if (report.wants("blocking_queue/batch" + suffix)) {
+            BlockingQueue<uint64_t> queue;
+            add("batch", runQueue(queue, n, n, perProducer, 64));
+        }
+        if (report.wants("blocking_queue/lockfree" + suffix)) {
+            LockFreeBlockingQueue<uint64_t> queue(4096);
+            add("lockfree", runQueue(queue, n, n, perProducer, 1));
+        }
+    }
+}
+
+// ---- Schedulers ----
+
+// `schedule(task)` must arrange for task() to run as soon as possible
+template <typename Schedule>
+void benchDispatch(Report& report, const std::string& name, std::size_t tasks, Schedule schedule) {
+    std::atomic<std::size_t> ran{0};
+    auto start = Clock::now();
+    for (std::size_t i = 0; i < tasks; ++i) {
+        schedule([&ran]() { ran.fetch_add(1, std::memory_order_relaxed); });
+    }
+    double scheduling = secondsSince(start);
+    while (ran.load(std::memory_order_relaxed) < tasks) std::this_thread::yield();
+    double total = secondsSince(start);
+    report.add({name, tasks,
+                {{"schedule_ns", scheduling * 1e9 / static_cast<double>(tasks)},
+                 {"dispatch_per_sec", static_cast<double>(tasks) / total}}});
+}
+
+void benchSchedulers(Report& report) {
+    std::size_t tasks = report.count(200000);
+    if (report.wants("scheduler/heap")) {
+        Scheduler scheduler(Scheduler::Backend::Heap);
+        benchDispatch(report, "scheduler/heap", tasks,
+                      [&](InplaceTask<> t) { scheduler.schedule(std::move(t), std::chrono::milliseconds(0)); });
+    }
+    if (report.wants("scheduler/wheel")) {
+        Scheduler scheduler(Scheduler::Backend::TimingWheel);
+        benchDispatch(report, "scheduler/wheel", tasks,
+                      [&](InplaceTask<> t) { scheduler.schedule(std::move(t), std::chrono::milliseconds(0)); });
+    }
+    if (report.wants("atomic_task_scheduler/inline")) {
+        AtomicTaskScheduler scheduler;
+        benchDispatch(report, "atomic_task_scheduler/inline", tasks,
+                      [&](InplaceTask<> t) { scheduler.scheduleAfter(std::move(t), 0); });
+    }
+    if (report.wants("atomic_task_scheduler/pool")) {
+        AtomicTaskScheduler scheduler(std::max(1u, std::thread::hardware_concurrency()));
+        benchDispatch(report, "atomic_task_scheduler/pool", tasks,
+                      [&](InplaceTask<> t) { scheduler.scheduleAfter(std::move(t), 0); });
+    }
+}
+
+// ---- Rate limiters and pool ----
+
+template <typename Op>
+void benchOp(Report& report, const std::string& name, std::size_t ops, Op op) {
+    if (!report.wants(name)) return;
+    uint64_t sink = 0;
+    auto start = Clock::now();
+    for (std::size_t i = 0; i < ops; ++i) sink += op(i) ? 1 : 0;
+    double seconds = secondsSince(start);
+    report.add({name, ops, {{"ns_per_op", seconds * 1e9 / static_cast<double>(ops)},
+                            {"granted_fraction", static_cast<double>(sink) / static_cast<double>(ops)}}});
+}
+
+void benchLimitersAndPool(Report& report) {
+    std::size_t ops = report.count(2000000);
+    {
+        LockFreeRateLimiter limiter(1000, 1e6);
+        benchOp(report, "rate_limiter/lockfree", ops, [&](std::size_t) { return limiter.tryConsume(); });
+    }
+    {
+        LockFreeRateLimiter limiter(1000, 1e6, LockFreeRateLimiter::defaultShards(), 32);
+        benchOp(report, "rate_limiter/sharded", ops, [&](std::size_t) { return limiter.tryConsume(); });
+    }
+    {
+        KeyedRateLimiter limiter(100000, 100.0, 10);
+        benchOp(report, "keyed_rate_limiter", ops,
+                [&](std::size_t i) { return limiter.tryConsume((i * 0x9e3779b97f4a7c15ULL) % 100000); });
+    }
+    if (report.wants("work_stealing_pool")) {
+        std::size_t tasks = report.count(500000);
+        WorkStealingPool pool;
+        benchDispatch(report, "work_stealing_pool", tasks, [&](InplaceTask<> t) { pool.submit(std::move(t)); });
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    options.maxThreads = static_cast<int>(std::max(4u, std::thread::hardware_concurrency()));
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!std::strcmp(argv[i], "--json")) options.jsonPath = argv[i + 1];
+        else if (!std::strcmp(argv[i], "--scale")) options.scale = std::atof(argv[i + 1]);
+        else if (!std::strcmp(argv[i], "--threads")) options.maxThreads = std::atoi(argv[i + 1]);
+        else if (!std::strcmp(argv[i], "--filter")) options.filter = argv[i + 1];
+        else {
+            std::fprintf(stderr, "usage: %s [--json FILE] [--scale X] [--threads N] [--filter TEXT]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    Report report(options);
+    benchFoo<lc1114::mutex_cv::Foo>(report, "mutex_cv", false);
+    benchFoo<lc1114::volatile_yield::Foo>(report, "volatile_yield", false);
+    benchFoo<lc1114::semaphore::Foo>(report, "semaphore", false);
+    benchFoo<lc1114::atomic_spin::Foo>(report, "atomic_spin", true);
+    benchFoo<lc1114::turn_sequencer::Foo>(report, "turn_sequencer", false);
+    benchFooBar<lc1115::semaphore::FooBar>(report, "semaphore");
+    benchFooBar<lc1115::mutex_cv::FooBar>(report, "mutex_cv");
+    benchFooBar<lc1115::volatile_yield::FooBar>(report, "volatile_yield");
+    benchFooBar<lc1115::turn_sequencer::FooBar>(report, "turn_sequencer");
+    benchQueues(report, options.maxThreads);
+    benchSchedulers(report);
+    benchLimitersAndPool(report);
+
+    std::FILE* out = options.jsonPath ? std::fopen(options.jsonPath, "w") : stdout;
+    if (!out) {
+        std::perror(options.jsonPath);
+        return 1;
+    }
+    report.write(out);
+    if (out != stdout) std::fclose(out);
+    return 0;
+}
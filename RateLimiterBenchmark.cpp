@@ -0,0 +1,129 @@
+/*
+Rate limiter scaling benchmark
+
+N threads call tryConsume() in a tight loop for a fixed time against one shared limiter, configured
+for 500k tokens per second with a burst of 1000:
+•	mutex: the mutex-protected token bucket of TokenBucketRateLimiter.cpp (reproduced below, since
+	that file is a standalone program).
+•	lockfree: LockFreeRateLimiter, one CAS on a single global word.
+•	sharded: LockFreeRateLimiter with one shard per CPU and batches of 32 tokens.
+
+For each thread count it reports attempted calls per second (the scaling number) and granted tokens
+per second (the accuracy number; the ideal is rate + burst / duration).
+
+Usage: RateLimiterBenchmark [milliseconds per run] [threads ...]   (default: 200, 1 2 4 8 16 32 64)
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "LockFreeRateLimiter.h"
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+constexpr double kRate = 500000.0;
+constexpr std::size_t kBurst = 1000;
+
+// The token bucket of TokenBucketRateLimiter.cpp, with the refill done at nanosecond resolution
+class MutexRateLimiter {
+public:
+    MutexRateLimiter(int maxTokens, int refillRate)
+        : maxTokens_(maxTokens), tokens_(maxTokens), refillRate_(refillRate), lastRefillTime_(Clock::now()) {}
+
+    bool tryConsume() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto now = Clock::now();
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(now - lastRefillTime_).count();
+        long long newTokens = (elapsed * refillRate_) / 1000000000LL;
+        if (newTokens > 0) {
+            tokens_ = static_cast<int>(std::min<long long>(maxTokens_, tokens_ + newTokens));
+            lastRefillTime_ = now;
+        }
+        if (tokens_ > 0) {
+            tokens_--;
+            return true;
+        }
+        return false;
+    }
+
+private:
+    int maxTokens_;
+    int tokens_;
+    long long refillRate_;
+    Clock::time_point lastRefillTime_;
+    std::mutex mutex_;
+};
+
+struct Result {
+    double callsPerSec;
+    double grantedPerSec;
+};
+
+template <typename Limiter>
+Result run(Limiter& limiter, int threads, std::chrono::milliseconds duration) {
+    std::atomic<bool> go{false};
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> calls{0};
+    std::atomic<uint64_t> granted{0};
+    std::vector<std::thread> workers;
+
+    for (int i = 0; i < threads; ++i) {
+        workers.emplace_back([&]() {
+            while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+            uint64_t myCalls = 0;
+            uint64_t myGranted = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                myGranted += limiter.tryConsume() ? 1 : 0;
+                ++myCalls;
+            }
+            calls.fetch_add(myCalls);
+            granted.fetch_add(myGranted);
+        });
+    }
+
+    auto start = Clock::now();
+    go.store(true, std::memory_order_release);
+    std::this_thread::sleep_for(duration);
+    stop.store(true);
+    for (auto& w : workers) w.join();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return {static_cast<double>(calls.load()) / seconds, static_cast<double>(granted.load()) / seconds};
+}
+
+void print(const char* name, int threads, const Result& r) {
+    std::printf("%-10s %4d %14.2f %14.0f\n", name, threads, r.callsPerSec / 1e6, r.grantedPerSec);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::chrono::milliseconds duration(argc > 1 ? std::atoi(argv[1]) : 200);
+    std::vector<int> threadCounts;
+    for (int i = 2; i < argc; ++i) threadCounts.push_back(std::atoi(argv[i]));
+    if (threadCounts.empty()) threadCounts = {1, 2, 4, 8, 16, 32, 64};
+
+    std::printf("target: %.0f tokens/s, burst %zu\n", kRate, kBurst);
+    std::printf("%-10s %4s %14s %14s\n", "limiter", "thr", "Mcalls/s", "granted/s");
+    for (int threads : threadCounts) {
+        {
+            MutexRateLimiter limiter(static_cast<int>(kBurst), static_cast<int>(kRate));
+            print("mutex", threads, run(limiter, threads, duration));
+        }
+        {
+            LockFreeRateLimiter limiter(kBurst, kRate);
+            print("lockfree", threads, run(limiter, threads, duration));
+        }
+        {
+            LockFreeRateLimiter limiter(kBurst, kRate, LockFreeRateLimiter::defaultShards(), 32);
+            print("sharded", threads, run(limiter, threads, duration));
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,261 @@
+#pragma once
+
+/*
+Scheduler: runs tasks after a delay on one worker thread
+
+Pending tasks are kept either in a binary min-heap or in a hierarchical timing wheel (see Backend).
+The worker sleeps on a condition variable until the earliest task is due, moves it out of the
+storage and runs it outside the lock. The destructor runs every task still pending, then joins.
+APIScheduler.cpp has a small demo.
+
+Slack: schedule(task, delay, slack) lets a task run anywhere in [due, due + slack]. The heap is
+ordered by due + slack, the worker sleeps until the earliest of those, and once awake it runs every
+task that is already due before sleeping again, so timers that are close together share one wakeup
+instead of getting one each. A task never runs early, nor later than its slack (plus scheduling
+delay). schedule() wakes the worker only if the new task must run before the worker's current
+deadline. The TimingWheel backend ignores slack (it already fires all timers of a 1ms tick
+together), and so do views.
+
+Backend::MultiQueue keeps the tasks in a MultiQueue (MultiQueue.h) instead of one heap behind the
+scheduler's mutex, so schedule() from many threads does not serialize: it pushes into one of the
+sub-heaps and takes the scheduler's mutex only when it has to wake the worker. The worker takes
+the task with the smallest deadline across the sub-heaps (tryPopMinIf), so the order is the heap's
+except for tasks scheduled at the same moment. Slack works as with the heap.
+
+WaitMode::TimerFd makes the worker sleep on a timerfd instead of the condition variable (TimerWait.h).
+
+Scheduler(TimerService&) makes a view instead: no thread, no mutex, no storage of its own. Tasks go
+to the service's per-core shards (TimerService.h) and the destructor waits until they have run.
+Use views when there are many schedulers, e.g. one per endpoint.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+#include "InplaceTask.h"
+#include "Metrics.h"
+#include "MultiQueue.h"
+#include "TimerService.h"
+#include "TimerWait.h"
+#include "TimingWheel.h"
+
+class Scheduler {
+public:
+    // Storage for pending tasks.
+    // Heap: binary min-heap, O(log n) insert and pop.
+    // TimingWheel: hierarchical timing wheel with 1ms ticks, O(1) insert and expiry;
+    // tasks fire at most one tick late, never early.
+    // MultiQueue: concurrent relaxed priority queue, for schedule() from many threads at once.
+    enum class Backend { Heap, TimingWheel, MultiQueue };
+
+    explicit Scheduler(Backend backend = Backend::Heap, WaitMode waitMode = WaitMode::ConditionVariable)
+        : backend_(backend), wait_(waitMode), stopFlag_(false) {
+        if (backend_ == Backend::MultiQueue) {
+            multiQueue_ = std::make_unique<MultiQueue<std::chrono::steady_clock::time_point, Task>>();
+        }
+        worker_ = std::thread([this] { this->run(); });
+    }
+
+    // A view onto service; the backend is the service's
+    explicit Scheduler(TimerService& service) : backend_(Backend::Heap), stopFlag_(false), service_(&service) {}
+
+    ~Scheduler() {
+        if (service_) {
+            pending_.wait();
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopFlag_ = true;
+        }
+        wait_.notify();
+        if (worker_.joinable()) {
+            worker_.join();
+        }
+    }
+
+    // Schedule a task to run after a delay, or up to `slack` later if that saves a wakeup
+    void schedule(InplaceTask<> task, std::chrono::steady_clock::duration delay,
+                  std::chrono::steady_clock::duration slack = std::chrono::steady_clock::duration::zero()) {
+        auto execTime = std::chrono::steady_clock::now() + delay;
+        if (service_) {
+            service_->schedule(std::move(task), execTime, &pending_);
+            return;
+        }
+        bool wake;
+        if (backend_ == Backend::MultiQueue) {
+            multiQueue_->push(execTime + slack, Task{execTime + slack, slack, std::move(task)});
+            // Pairs with the fence in runMultiQueue: either the worker's scan sees the task, or this
+            // sees the deadline the worker is about to sleep until
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            wake = execTime + slack < sleepUntil_.load(std::memory_order_relaxed);
+            if (wake) {
+                std::lock_guard<std::mutex> lock(mutex_); // The worker is not between its scan and its wait
+            }
+        } else {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (backend_ == Backend::TimingWheel) {
+                wheel_.insert(execTime, std::move(task));
+                wake = execTime < sleepUntil_.load();
+            } else {
+                tasks_.push_back(Task{execTime + slack, slack, std::move(task)});
+                std::push_heap(tasks_.begin(), tasks_.end(), Compare());
+                wake = execTime + slack < sleepUntil_.load();
+            }
+        }
+        if (wake) {
+            wait_.notify();
+        }
+    }
+
+private:
+    struct Task {
+        std::chrono::steady_clock::time_point deadline; // Due time + slack: the latest it may run
+        std::chrono::steady_clock::duration slack;
+        InplaceTask<> task;
+
+        std::chrono::steady_clock::time_point due() const { return deadline - slack; }
+    };
+    struct Compare {
+        bool operator()(const Task& a, const Task& b) const {
+            return a.deadline > b.deadline;
+        }
+    };
+
+    Backend backend_;
+    std::vector<Task> tasks_; // Min-heap by deadline, kept with std::push_heap / std::pop_heap, so the due task can be moved out
+    HierarchicalTimingWheel<InplaceTask<>> wheel_{std::chrono::milliseconds(1)};
+    std::unique_ptr<MultiQueue<std::chrono::steady_clock::time_point, Task>> multiQueue_; // Backend::MultiQueue only
+    std::mutex mutex_;
+    TimerWait wait_;
+    // When the sleeping worker wakes up by itself; min() while it is awake, so nobody has to wake it.
+    // Written under mutex_; atomic because the MultiQueue backend's schedule() reads it without.
+    std::atomic<std::chrono::steady_clock::time_point> sleepUntil_{std::chrono::steady_clock::time_point::min()};
+    std::thread worker_;
+    std::atomic<bool> stopFlag_;
+    TimerService* service_ = nullptr; // Set for a view
+    TimerService::Group pending_;     // A view's tasks that have not run yet
+
+    void run() {
+        if (backend_ == Backend::TimingWheel) {
+            runWheel();
+            return;
+        }
+        if (backend_ == Backend::MultiQueue) {
+            runMultiQueue();
+            return;
+        }
+        bool woke = false; // The last wait was a timed one
+        while (true) {
+            InplaceTask<> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                if (stopFlag_ && tasks_.empty()) break;
+                auto now = std::chrono::steady_clock::now();
+                if (!tasks_.empty() && tasks_.front().due() <= now) {
+                    // Due, though maybe not at its deadline yet: run it in this wakeup
+                    Metrics::record(Metrics::Lateness, now - tasks_.front().due());
+                    Metrics::record(Metrics::QueueDepth, tasks_.size());
+                    std::pop_heap(tasks_.begin(), tasks_.end(), Compare());
+                    task = std::move(tasks_.back().task);
+                    tasks_.pop_back();
+                    woke = false;
+                } else {
+                    if (woke) {
+                        Metrics::count(Metrics::SpuriousWakeups);
+                    }
+                    sleepUntil_ = tasks_.empty() ? std::chrono::steady_clock::time_point::max() : tasks_.front().deadline;
+                    wait_.waitUntil(lock, sleepUntil_.load());
+                    sleepUntil_ = std::chrono::steady_clock::time_point::min();
+                    woke = !tasks_.empty();
+                    if (woke) {
+                        Metrics::count(Metrics::Wakeups);
+                    }
+                }
+            }
+            if (task) {
+                Metrics::ScopedTimer timer(Metrics::Execution);
+                task();
+            }
+        }
+    }
+
+    // Same loop for the MultiQueue; the mutex only guards the sleep, not the tasks
+    void runMultiQueue() {
+        using TimePoint = std::chrono::steady_clock::time_point;
+        bool woke = false;
+        while (true) {
+            auto now = std::chrono::steady_clock::now();
+            TimePoint deadline;
+            Task task;
+            if (multiQueue_->tryPopMinIf([now](const TimePoint&, const Task& t) { return t.due() <= now; }, deadline, task)) {
+                Metrics::record(Metrics::Lateness, now - task.due());
+                Metrics::record(Metrics::QueueDepth, multiQueue_->size() + 1);
+                woke = false;
+                Metrics::ScopedTimer timer(Metrics::Execution);
+                task.task();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (stopFlag_ && multiQueue_->empty()) break;
+            std::optional<TimePoint> earliest = multiQueue_->minKey();
+            sleepUntil_ = earliest ? *earliest : TimePoint::max();
+            // A task pushed before sleepUntil_ was published: schedule() may have missed it, this does not
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            std::optional<TimePoint> recheck = multiQueue_->minKey();
+            if (recheck && *recheck < sleepUntil_.load()) {
+                sleepUntil_ = TimePoint::min();
+                continue;
+            }
+            if (woke) {
+                Metrics::count(Metrics::SpuriousWakeups);
+            }
+            wait_.waitUntil(lock, sleepUntil_.load());
+            sleepUntil_ = TimePoint::min();
+            woke = !multiQueue_->empty();
+            if (woke) {
+                Metrics::count(Metrics::Wakeups);
+            }
+        }
+    }
+
+    // Same loop for the timing wheel; every task that expired by the wakeup runs as one batch
+    void runWheel() {
+        std::vector<InplaceTask<>> due;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                if (stopFlag_ && wheel_.empty()) break;
+                if (wheel_.empty()) {
+                    sleepUntil_ = std::chrono::steady_clock::time_point::max();
+                    wait_.wait(lock);
+                    sleepUntil_ = std::chrono::steady_clock::time_point::min();
+                    continue;
+                }
+                sleepUntil_ = *wheel_.nextWakeup();
+                wait_.waitUntil(lock, sleepUntil_.load());
+                sleepUntil_ = std::chrono::steady_clock::time_point::min();
+                Metrics::count(Metrics::Wakeups);
+                std::size_t pending = wheel_.size();
+                if (wheel_.advance(std::chrono::steady_clock::now(), [&due](InplaceTask<>&& task) {
+                        due.push_back(std::move(task));
+                    }) == 0 && pending > 0) {
+                    Metrics::count(Metrics::SpuriousWakeups);
+                }
+                if (!due.empty()) {
+                    Metrics::record(Metrics::QueueDepth, pending);
+                }
+            }
+            for (auto& task : due) {
+                Metrics::ScopedTimer timer(Metrics::Execution);
+                task();
+            }
+            due.clear();
+        }
+    }
+};
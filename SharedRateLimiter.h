@@ -0,0 +1,173 @@
+#pragma once
+
+/*
+SharedRateLimiter: token bucket shared by every process on a host (POSIX shared memory)
+
+Processes that each run their own limiter with 1/N of the quota waste it whenever the load is
+uneven: an idle process's share goes unused while a busy one is throttled. SharedRateLimiter keeps
+one bucket in a shm_open()/mmap() segment, named like the shm object ("/upstream-quota"), that all
+processes map. It is the unsharded LockFreeRateLimiter laid out in shared memory: the whole state is
+one 64-bit "emptyAt" instant, refilling is implicit and tryConsume(n) is one CAS that moves emptyAt
+forward by n * costPerToken. Consuming takes no lock and makes no system call. The arithmetic and its
+range checks are LockFreeRateLimiter.h's EmptyAtBucket, applied to the word in the segment.
+
+•	Weighted consumption: tryConsume(n) takes n tokens or none; reserve(n) takes them in any case and
+	returns when they exist. A request above maxTokens never succeeds: tryConsume() returns false and
+	reserve() throws std::invalid_argument.
+•	Crashes: there is no lock to leave held. A process killed in the middle of tryConsume() has
+	either moved emptyAt or not. Exactly one process initializes the segment: it claims it by
+	swapping the zero-filled magic word for "initializing by <pid>" with a CAS. A process that finds
+	the claim held by a dead pid takes it over; one that finds it held by a live process waits up to
+	initTimeout for it (std::system_error(ETIMEDOUT) after that). A bucket is never initialized
+	twice, so its state is never reset under the processes using it.
+•	Time is absolute CLOCK_MONOTONIC (steady_clock), which all processes on a host share, so there
+	is no per-segment origin to agree on. It is kept in fixed point (1/16 ns), which lasts for 18
+	years of uptime.
+•	The first process creates the segment with its parameters; later ones must pass the same ones
+	(std::invalid_argument otherwise, as for a rate or burst out of LockFreeRateLimiter's range). The
+	segment outlives the processes until remove(name).
+
+Linux only (shm_open, mmap). Failing system calls throw std::system_error.
+*/
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#include "LockFreeRateLimiter.h"
+
+class SharedRateLimiter {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Attach to the bucket called `name`, creating it (full) if it does not exist yet
+    SharedRateLimiter(const std::string& name, std::size_t maxTokens, double refillRatePerSec,
+                      Clock::duration initTimeout = std::chrono::seconds(1))
+        : bucket_(maxTokens, refillRatePerSec) {
+        if (maxTokens == 0) {
+            throw std::invalid_argument("SharedRateLimiter: maxTokens must be positive");
+        }
+        int64_t cost = bucket_.costPerToken();
+        int64_t burst = bucket_.burst();
+
+        int fd = shm_open(name.c_str(), O_RDWR | O_CREAT, 0600);
+        if (fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "shm_open");
+        }
+        // Every process sets the size, so a process that created the object and died before doing it
+        // does not matter
+        if (ftruncate(fd, sizeof(Segment)) != 0) {
+            int error = errno;
+            close(fd);
+            throw std::system_error(error, std::generic_category(), "ftruncate");
+        }
+        void* mapping = mmap(nullptr, sizeof(Segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        int error = errno;
+        close(fd); // The mapping keeps the object alive
+        if (mapping == MAP_FAILED) {
+            throw std::system_error(error, std::generic_category(), "mmap");
+        }
+        segment_ = static_cast<Segment*>(mapping);
+
+        try {
+            initializeOnce(cost, burst, initTimeout);
+        } catch (...) {
+            munmap(segment_, sizeof(Segment));
+            throw;
+        }
+        if (segment_->costPerToken.load(std::memory_order_relaxed) != cost ||
+            segment_->burst.load(std::memory_order_relaxed) != burst) {
+            munmap(segment_, sizeof(Segment));
+            throw std::invalid_argument("SharedRateLimiter: '" + name + "' exists with other parameters");
+        }
+    }
+
+    ~SharedRateLimiter() { munmap(segment_, sizeof(Segment)); }
+
+    SharedRateLimiter(const SharedRateLimiter&) = delete;
+    SharedRateLimiter& operator=(const SharedRateLimiter&) = delete;
+
+    // Delete the shared object; processes that have it mapped keep using it
+    static void remove(const std::string& name) { shm_unlink(name.c_str()); }
+
+    // Take `tokens` tokens if they are available right now; never more than maxTokens
+    bool tryConsume(uint64_t tokens = 1) {
+        if (!bucket_.fits(tokens)) {
+            return false;
+        }
+        int64_t n = static_cast<int64_t>(tokens);
+        return bucket_.take(segment_->emptyAt, now(), n, n) == n;
+    }
+
+    // Take `tokens` tokens whether or not they are there, and return when they are (see
+    // LockFreeRateLimiter::reserve). Reservations from all processes are served in order.
+    // Throws std::invalid_argument for more than maxTokens tokens.
+    Clock::time_point reserve(uint64_t tokens = 1) {
+        return Clock::time_point(EmptyAtBucket::fromFixed(bucket_.reserve(segment_->emptyAt, now(), tokens)));
+    }
+
+    // Whole tokens in the bucket right now
+    uint64_t available() const { return bucket_.available(segment_->emptyAt, now()); }
+
+private:
+    static constexpr uint64_t kMagic = 0x53524c696d697431; // Set once the segment is initialized
+    static constexpr uint64_t kInitializing = 0x53524c69ULL << 32; // | pid of the initializing process
+
+    // Zero-filled when created. Only lock-free atomics, which work across processes.
+    struct Segment {
+        std::atomic<uint64_t> magic;       // 0, kInitializing | pid, then kMagic
+        std::atomic<int64_t> costPerToken; // Fixed-point time that refills one token
+        std::atomic<int64_t> burst;        // Fixed-point time that refills the whole bucket
+        alignas(64) std::atomic<int64_t> emptyAt;
+    };
+    static_assert(std::atomic<int64_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free,
+                  "shared-memory atomics must be lock-free");
+
+    const EmptyAtBucket bucket_;
+    Segment* segment_ = nullptr;
+
+    static int64_t now() {
+        return EmptyAtBucket::toFixed(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()));
+    }
+
+    // Initialize the segment unless it is or some other process is initializing it. The CAS on
+    // the magic word lets exactly one process in; a claim left by a process that died is taken over.
+    void initializeOnce(int64_t cost, int64_t burst, Clock::duration timeout) {
+        auto deadline = Clock::now() + timeout;
+        uint64_t claim = kInitializing | static_cast<uint32_t>(getpid());
+        uint64_t magic = segment_->magic.load(std::memory_order_acquire);
+        while (magic != kMagic) {
+            bool vacant = magic == 0 || ((magic & ~uint64_t{UINT32_MAX}) == kInitializing && !alive(static_cast<pid_t>(magic & UINT32_MAX)));
+            if (vacant) {
+                if (segment_->magic.compare_exchange_strong(magic, claim, std::memory_order_acquire)) {
+                    // Parameters first, then the magic
+                    segment_->costPerToken.store(cost, std::memory_order_relaxed);
+                    segment_->burst.store(burst, std::memory_order_relaxed);
+                    segment_->emptyAt.store(now() - burst, std::memory_order_relaxed); // Start full
+                    segment_->magic.store(kMagic, std::memory_order_release);
+                    return;
+                }
+                continue; // magic holds the value that beat us
+            }
+            if (Clock::now() >= deadline) {
+                throw std::system_error(ETIMEDOUT, std::generic_category(), "SharedRateLimiter: waiting for initialization");
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+            magic = segment_->magic.load(std::memory_order_acquire);
+        }
+    }
+
+    // Whether process pid still exists (EPERM: it does, but belongs to another user)
+    static bool alive(pid_t pid) { return kill(pid, 0) == 0 || errno == EPERM; }
+};
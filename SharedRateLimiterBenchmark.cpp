@@ -0,0 +1,137 @@
+/*
+SharedRateLimiter: one budget for many processes, against one limiter per process
+
+P processes are forked; only a quarter of them want tokens at any moment (the busy quarter rotates
+every 100ms), the others sleep. Each busy process calls tryConsume() in a loop for S seconds.
+•	split: every process has its own LockFreeRateLimiter with maxTokens / P and rate / P, the way
+	per-process limiters are usually sized. The idle processes' shares are lost.
+•	shared: all processes use one SharedRateLimiter with maxTokens and rate.
+Reports the tokens granted in total, the most the quota allows over the run (maxTokens + rate * S)
+and their ratio; shared should be close to 100% and never above it.
+Then one process is killed with SIGKILL while it consumes in a loop, and the parent checks that the
+bucket still works (weighted tryConsume and reserve).
+
+Usage: SharedRateLimiterBenchmark [processes] [rate/s] [seconds]   (default: 24 100000 2)
+---
+Output on a single-core machine (numbers vary by machine):
+mode          granted        quota     used %
+split           51139       201000       25.4
+shared         200914       201000      100.0
+after SIGKILL: tryConsume(100) ok, reserve(1000) ready in 1.0 ms
+*/
+
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include "LockFreeRateLimiter.h"
+#include "SharedRateLimiter.h"
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+constexpr std::size_t maxTokens = 1000;
+
+// Counters the children report into: an anonymous shared mapping made before fork()
+std::atomic<uint64_t>* sharedCounters(std::size_t n) {
+    void* memory = mmap(nullptr, n * sizeof(std::atomic<uint64_t>), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        std::perror("mmap");
+        std::exit(1);
+    }
+    return new (memory) std::atomic<uint64_t>[n]();
+}
+
+// Run body(index) in `processes` children and wait for all of them
+template <typename Body>
+void forkAll(int processes, Body body) {
+    for (int i = 0; i < processes; ++i) {
+        if (fork() == 0) {
+            body(i);
+            _exit(0);
+        }
+    }
+    while (wait(nullptr) > 0) {
+    }
+}
+
+// Busy quarter of the processes for this 100ms period
+bool busy(int index, Clock::time_point start) {
+    auto period = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count() / 100;
+    return index % 4 == period % 4;
+}
+
+template <typename Limiter>
+uint64_t consume(Limiter& limiter, int index, Clock::time_point start, Clock::time_point end) {
+    uint64_t granted = 0;
+    while (Clock::now() < end) {
+        if (!busy(index, start)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        } else if (limiter.tryConsume()) {
+            ++granted;
+        }
+    }
+    return granted;
+}
+
+void report(const char* mode, uint64_t granted, double quota) {
+    std::printf("%-8s %12llu %12.0f %10.1f\n", mode, static_cast<unsigned long long>(granted), quota,
+                100.0 * static_cast<double>(granted) / quota);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int processes = argc > 1 ? std::atoi(argv[1]) : 24;
+    double rate = argc > 2 ? std::atof(argv[2]) : 100000;
+    double seconds = argc > 3 ? std::atof(argv[3]) : 2;
+    auto runFor = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+    double quota = static_cast<double>(maxTokens) + rate * seconds;
+    std::atomic<uint64_t>* granted = sharedCounters(2);
+    std::string name = "/concurrency-bench-" + std::to_string(getpid());
+
+    std::printf("%-8s %12s %12s %10s\n", "mode", "granted", "quota", "used %");
+    auto start = Clock::now();
+    forkAll(processes, [&](int i) {
+        LockFreeRateLimiter own(maxTokens / static_cast<std::size_t>(processes), rate / processes);
+        granted[0] += consume(own, i, start, start + runFor);
+    });
+    report("split", granted[0], quota);
+
+    SharedRateLimiter::remove(name);
+    start = Clock::now();
+    forkAll(processes, [&](int i) {
+        SharedRateLimiter shared(name, maxTokens, rate);
+        granted[1] += consume(shared, i, start, start + runFor);
+    });
+    report("shared", granted[1], quota);
+
+    // A consumer killed at an arbitrary point cannot leave anything locked
+    SharedRateLimiter limiter(name, maxTokens, rate);
+    pid_t child = fork();
+    if (child == 0) {
+        SharedRateLimiter shared(name, maxTokens, rate);
+        while (true) {
+            shared.tryConsume(3);
+        }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    kill(child, SIGKILL);
+    waitpid(child, nullptr, 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20)); // Let the bucket refill a little
+    bool weighted = limiter.tryConsume(100);
+    auto ready = limiter.reserve(maxTokens);
+    std::printf("after SIGKILL: tryConsume(100) %s, reserve(%zu) ready in %.1f ms\n", weighted ? "ok" : "FAILED", maxTokens,
+                std::chrono::duration<double, std::milli>(ready - Clock::now()).count());
+    SharedRateLimiter::remove(name);
+    return 0;
+}
@@ -0,0 +1,139 @@
+/*
+Allocations and copies per scheduled task
+
+Every task captures 40 bytes (a request id, a pointer and a small payload), a typical callback size
+that is already too big for std::function's inline buffer. Each row schedules N tasks, dispatches
+them in time order and runs them, counting global operator new calls (AllocationCounter.h) and copies
+of the captured state:
+•	function/top: std::function in a std::priority_queue, dispatched with `auto t = top(); pop();`
+	(the schedulers before InplaceTask).
+•	inplace/move: InplaceTask in a std::push_heap / std::pop_heap vector, moved out of the heap (what
+	Scheduler and APIScheduler do now). The vector is warmed up, so only per-task costs show.
+•	pool: InplaceTask submitted to a 4-worker WorkStealingPool from an outside thread in bursts of
+	kBurst, as AtomicTaskScheduler does in worker pool mode; measured after a warm-up round.
+
+Usage: TaskAllocBenchmark [tasks]   (default: 1000000)
+---
+Expected output (counts do not depend on the machine):
+path             allocs/task   copies/task
+function/top           2.000         1.000
+inplace/move           0.000         0.000
+pool                   0.000         0.000
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <queue>
+#include <thread>
+#include <vector>
+#include "AllocationCounter.h"
+#include "InplaceTask.h"
+#include "WorkStealingPool.h"
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+constexpr std::size_t kBurst = 4096;
+
+std::atomic<uint64_t> copies{0};
+std::atomic<uint64_t> executed{0};
+
+// 40 bytes of captured state that counts its copies
+struct Capture {
+    uint64_t requestId;
+    const void* context;
+    uint64_t payload[3];
+
+    Capture(uint64_t id) : requestId(id), context(nullptr), payload{id, id, id} {}
+    Capture(const Capture& other) : requestId(other.requestId), context(other.context) {
+        std::copy(other.payload, other.payload + 3, payload);
+        copies.fetch_add(1, std::memory_order_relaxed);
+    }
+    Capture(Capture&&) noexcept = default;
+};
+
+auto makeCallback(uint64_t id) {
+    return [capture = Capture(id)]() { executed.fetch_add(capture.payload[0] != UINT64_MAX, std::memory_order_relaxed); };
+}
+
+template <typename Task>
+struct Timed {
+    Clock::time_point when;
+    Task task;
+    bool operator>(const Timed& other) const { return when > other.when; }
+};
+
+void print(const char* name, uint64_t allocs, uint64_t copied, std::size_t n) {
+    std::printf("%-14s %13.3f %13.3f\n", name, static_cast<double>(allocs) / static_cast<double>(n),
+                static_cast<double>(copied) / static_cast<double>(n));
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    auto base = Clock::now();
+    auto when = [base](std::size_t i) { return base + std::chrono::microseconds((i * 7919) % 1000003); };
+
+    std::printf("%-14s %13s %13s\n", "path", "allocs/task", "copies/task");
+    {
+        using Item = Timed<std::function<void()>>;
+        std::vector<Item> storage;
+        storage.reserve(n);
+        std::priority_queue<Item, std::vector<Item>, std::greater<Item>> queue(std::greater<Item>(), std::move(storage));
+        uint64_t allocs = allocationCount();
+        copies = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            queue.push({when(i), makeCallback(i)});
+        }
+        while (!queue.empty()) {
+            auto next = queue.top();
+            queue.pop();
+            next.task();
+        }
+        print("function/top", allocationCount() - allocs, copies.load(), n);
+    }
+    {
+        using Item = Timed<InplaceTask<>>;
+        std::vector<Item> heap;
+        heap.reserve(n);
+        uint64_t allocs = allocationCount();
+        copies = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            heap.push_back({when(i), makeCallback(i)});
+            std::push_heap(heap.begin(), heap.end(), std::greater<Item>());
+        }
+        while (!heap.empty()) {
+            std::pop_heap(heap.begin(), heap.end(), std::greater<Item>());
+            InplaceTask<> task = std::move(heap.back().task);
+            heap.pop_back();
+            task();
+        }
+        print("inplace/move", allocationCount() - allocs, copies.load(), n);
+    }
+    {
+        WorkStealingPool pool(4);
+        // Bursts of due tasks, as a scheduler thread hands them over, each one finished before the next
+        auto round = [&pool, n]() {
+            for (std::size_t i = 0; i < n; i += kBurst) {
+                uint64_t target = executed.load() + std::min(kBurst, n - i);
+                for (std::size_t j = i; j < std::min(i + kBurst, n); ++j) {
+                    pool.submit(makeCallback(j));
+                }
+                while (executed.load() < target) std::this_thread::yield();
+            }
+        };
+        round(); // Grows the deques and fills the node caches
+        uint64_t allocs = allocationCount();
+        copies = 0;
+        round();
+        print("pool", allocationCount() - allocs, copies.load(), n);
+    }
+    return 0;
+}
@@ -0,0 +1,188 @@
+#pragma once
+
+/*
+TaskGraph: run a DAG of tasks on a WorkStealingPool, each task after all of its predecessors
+
+LC1114's Foo orders three calls with a shared counter; TaskGraph does the same for any number of
+steps and any dependency structure:
+	TaskGraph graph;
+	auto load = graph.add([] { ... });
+	auto parse = graph.add([] { ... });
+	graph.precede(load, parse);           // parse runs after load
+	graph.run(pool);                      // blocks until every task has run; may be called again
+
+How a run works
+•	Every node has an atomic count of predecessors that have not finished yet. run() resets the
+	counts and submits the nodes that have none.
+•	When a node finishes it decrements each successor's count; the thread that brings a count to zero
+	owns that successor. All but one of the successors it owns are submitted to the pool (on a worker
+	that is the worker's own deque, so idle workers steal them); the last one runs right away on the
+	same thread, so a chain never goes through a deque at all.
+•	A count of unfinished nodes tells run() when the graph is done. The thread finishing the last node
+	signals run() through a mutex and condition variable, once per run: unlike a notify on a bare
+	atomic, this never touches the graph after run() may have returned and the caller freed it.
+
+Reuse
+Building a graph allocates; running it does not. The first run() after add()/precede() lays out the
+edges in one flat array (successors of node i are successors_[offsets_[i] .. offsets_[i + 1]]) and
+sizes the counters; later runs only reset counters. Tasks are InplaceTask and are called, not
+consumed, so they run again on every run(). Pool submissions capture two pointers and reuse the
+pool's recycled nodes.
+
+Rules
+•	Edges must form a DAG; a cycle makes run() wait forever. precede() does not check.
+•	One run() of a graph at a time, and the graph must not be modified during a run. Different
+	graphs can run on the same pool concurrently from different threads.
+•	run() blocks, so do not call it from a task running on the same pool: with every worker blocked
+	in run() nothing is left to execute the nodes.
+•	If a task throws, the tasks that have not started yet are skipped (their dependency counting still
+	happens, so the run completes), and run() rethrows the first exception.
+*/
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "InplaceTask.h"
+#include "WorkStealingPool.h"
+
+class TaskGraph {
+public:
+    using Task = InplaceTask<>;
+    using NodeId = uint32_t;
+
+    TaskGraph() = default;
+    TaskGraph(const TaskGraph&) = delete;
+    TaskGraph& operator=(const TaskGraph&) = delete;
+
+    NodeId add(Task task) {
+        nodes_.push_back(Node{std::move(task), {}, 0});
+        sealed_ = false;
+        return static_cast<NodeId>(nodes_.size() - 1);
+    }
+
+    // `after` runs only once `before` has finished
+    void precede(NodeId before, NodeId after) {
+        if (before >= nodes_.size() || after >= nodes_.size() || before == after) {
+            throw std::invalid_argument("TaskGraph::precede: bad node id");
+        }
+        nodes_[before].successors.push_back(after);
+        ++nodes_[after].predecessors;
+        sealed_ = false;
+    }
+
+    std::size_t size() const { return nodes_.size(); }
+
+    // Run every task once, respecting the edges; returns when all have finished
+    void run(WorkStealingPool& pool) {
+        if (nodes_.empty()) return;
+        seal();
+
+        pool_ = &pool;
+        failed_.store(false, std::memory_order_relaxed);
+        error_ = nullptr;
+        for (std::size_t i = 0; i < nodes_.size(); ++i) {
+            pending_[i].store(nodes_[i].predecessors, std::memory_order_relaxed);
+        }
+        remaining_.store(static_cast<uint32_t>(nodes_.size()), std::memory_order_relaxed);
+        finished_ = false;
+
+        // The release in submit's deque push publishes the counters to the workers
+        for (NodeId root : roots_) {
+            submit(root);
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(doneMutex_);
+            done_.wait(lock, [this] { return finished_; });
+        }
+        pool_ = nullptr;
+        if (error_) {
+            std::rethrow_exception(std::exchange(error_, nullptr));
+        }
+    }
+
+private:
+    struct Node {
+        Task task;
+        std::vector<NodeId> successors; // Build-time adjacency; flattened by seal()
+        uint32_t predecessors;
+    };
+
+    std::vector<Node> nodes_;
+    bool sealed_ = false;
+
+    // Laid out by seal(), reused by every run
+    std::vector<NodeId> offsets_;
+    std::vector<NodeId> successors_;
+    std::vector<NodeId> roots_;
+    std::unique_ptr<std::atomic<uint32_t>[]> pending_;
+
+    WorkStealingPool* pool_ = nullptr;
+    alignas(64) std::atomic<uint32_t> remaining_{0};
+    std::mutex doneMutex_;
+    std::condition_variable done_;
+    bool finished_ = false;
+    std::atomic<bool> failed_{false};
+    std::mutex errorMutex_;
+    std::exception_ptr error_;
+
+    void seal() {
+        if (sealed_) return;
+        offsets_.assign(nodes_.size() + 1, 0);
+        successors_.clear();
+        roots_.clear();
+        for (std::size_t i = 0; i < nodes_.size(); ++i) {
+            offsets_[i] = static_cast<NodeId>(successors_.size());
+            successors_.insert(successors_.end(), nodes_[i].successors.begin(), nodes_[i].successors.end());
+            if (nodes_[i].predecessors == 0) roots_.push_back(static_cast<NodeId>(i));
+        }
+        offsets_[nodes_.size()] = static_cast<NodeId>(successors_.size());
+        pending_.reset(new std::atomic<uint32_t>[nodes_.size()]);
+        sealed_ = true;
+    }
+
+    void submit(NodeId id) {
+        pool_->submit([this, id] { execute(id); });
+    }
+
+    // Run a node, then whichever successor it readied last, and so on down the chain
+    void execute(NodeId id) {
+        while (true) {
+            if (!failed_.load(std::memory_order_relaxed)) {
+                try {
+                    nodes_[id].task();
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(errorMutex_);
+                    if (!error_) error_ = std::current_exception();
+                    failed_.store(true, std::memory_order_relaxed);
+                }
+            }
+
+            NodeId next = UINT32_MAX;
+            for (NodeId e = offsets_[id]; e < offsets_[id + 1]; ++e) {
+                NodeId successor = successors_[e];
+                if (pending_[successor].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    if (next != UINT32_MAX) submit(next);
+                    next = successor;
+                }
+            }
+
+            // Last finisher wakes run(); once the lock is released the graph may be gone
+            if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                std::lock_guard<std::mutex> lock(doneMutex_);
+                finished_ = true;
+                done_.notify_all();
+                return;
+            }
+            if (next == UINT32_MAX) return;
+            id = next;
+        }
+    }
+};
@@ -0,0 +1,139 @@
+/*
+TaskGraph scheduling overhead
+
+Every node does the same trivial work (one relaxed increment), so the time per node is almost
+entirely TaskGraph's own cost: dependency counting, deque pushes, steals and wake-ups. Shapes:
+•	chain:  N nodes in a line, each depending on the previous one. No parallelism; every node is
+	readied by its predecessor and continued inline on the same worker.
+•	fanout: one root, N - 2 independent middle nodes, one sink depending on all of them. The root's
+	worker submits N - 3 nodes to its own deque and the others steal them; the sink waits for all.
+•	layers: rows of 64 nodes, each node depending on two nodes of the row above (a butterfly-like
+	mesh), the shape of a batch job with stages.
+
+Each graph is built once and run R times on the same WorkStealingPool. Reported per shape:
+•	ns/node: wall time of the timed runs divided by nodes run.
+•	overhead: ns/node minus the cost of calling the same tasks in a plain loop.
+•	allocs/run: global operator new calls per timed run (AllocationCounter.h). The timed runs follow
+	warm-up runs, which end once kWarmRuns runs in a row allocated nothing; a reused graph then
+	needs no allocation at all.
+
+Usage: TaskGraphBenchmark [nodes] [runs] [workers]   (default: 10000 50 hardware_concurrency)
+---
+Output on a single-core machine (numbers vary by machine; allocs/run should be 0):
+shape        nodes   runs    ns/node   overhead   allocs/run
+chain        10000     50       20.5       10.4        0.000
+fanout       10000     50       65.4       55.3        0.000
+layers        9984     50       44.2       34.1        0.000
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include "AllocationCounter.h"
+#include "TaskGraph.h"
+#include "WorkStealingPool.h"
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+constexpr std::size_t kRowWidth = 64;
+constexpr std::size_t kWarmRuns = 8;
+constexpr std::size_t kMaxWarmRuns = 1000;
+
+std::atomic<uint64_t> executed{0};
+
+void work() { executed.fetch_add(1, std::memory_order_relaxed); }
+
+void buildChain(TaskGraph& graph, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+        TaskGraph::NodeId id = graph.add(work);
+        if (i > 0) graph.precede(id - 1, id);
+    }
+}
+
+void buildFanout(TaskGraph& graph, std::size_t n) {
+    n = std::max<std::size_t>(n, 3);
+    TaskGraph::NodeId root = graph.add(work);
+    TaskGraph::NodeId sink = graph.add(work);
+    for (std::size_t i = 0; i < n - 2; ++i) {
+        TaskGraph::NodeId id = graph.add(work);
+        graph.precede(root, id);
+        graph.precede(id, sink);
+    }
+}
+
+void buildLayers(TaskGraph& graph, std::size_t n) {
+    std::size_t rows = std::max<std::size_t>(n / kRowWidth, 1);
+    for (std::size_t r = 0; r < rows; ++r) {
+        for (std::size_t c = 0; c < kRowWidth; ++c) {
+            TaskGraph::NodeId id = graph.add(work);
+            if (r == 0) continue;
+            TaskGraph::NodeId above = static_cast<TaskGraph::NodeId>((r - 1) * kRowWidth);
+            graph.precede(above + static_cast<TaskGraph::NodeId>(c), id);
+            graph.precede(above + static_cast<TaskGraph::NodeId>((c + (1u << (r % 6))) % kRowWidth), id);
+        }
+    }
+}
+
+double loopNsPerNode(std::size_t n, std::size_t runs) {
+    TaskGraph::Task task(work);
+    auto start = Clock::now();
+    for (std::size_t r = 0; r < runs; ++r) {
+        for (std::size_t i = 0; i < n; ++i) task();
+    }
+    std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+    return elapsed.count() / static_cast<double>(n * runs);
+}
+
+void bench(const char* shape, void (*build)(TaskGraph&, std::size_t), std::size_t n, std::size_t runs,
+           WorkStealingPool& pool) {
+    TaskGraph graph;
+    build(graph, n);
+    std::size_t nodes = graph.size();
+
+    // The first run lays out the graph; the pool needs more to grow its deques and fill the node caches
+    // of every thread, so warm up until kWarmRuns runs in a row allocate nothing
+    std::size_t quiet = 0;
+    for (std::size_t r = 0; r < kMaxWarmRuns && quiet < kWarmRuns; ++r) {
+        uint64_t before = allocationCount();
+        graph.run(pool);
+        quiet = allocationCount() == before ? quiet + 1 : 0;
+    }
+    executed = 0;
+    uint64_t allocs = allocationCount();
+    auto start = Clock::now();
+    for (std::size_t r = 0; r < runs; ++r) {
+        graph.run(pool);
+    }
+    std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+    allocs = allocationCount() - allocs;
+
+    if (executed.load() != nodes * runs) {
+        std::fprintf(stderr, "%s: ran %llu nodes, expected %zu\n", shape,
+                     static_cast<unsigned long long>(executed.load()), nodes * runs);
+        std::exit(1);
+    }
+    double perNode = elapsed.count() / static_cast<double>(nodes * runs);
+    std::printf("%-8s %9zu %6zu %10.1f %10.1f %12.3f\n", shape, nodes, runs, perNode,
+                perNode - loopNsPerNode(nodes, runs), static_cast<double>(allocs) / static_cast<double>(runs));
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000;
+    std::size_t runs = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 50;
+    std::size_t workers = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : std::thread::hardware_concurrency();
+
+    WorkStealingPool pool(std::max<std::size_t>(workers, 1));
+    std::printf("%-8s %9s %6s %10s %10s %12s\n", "shape", "nodes", "runs", "ns/node", "overhead", "allocs/run");
+    bench("chain", buildChain, n, runs, pool);
+    bench("fanout", buildFanout, n, runs, pool);
+    bench("layers", buildLayers, n, runs, pool);
+    return 0;
+}
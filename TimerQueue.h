@@ -0,0 +1,235 @@
+#pragma once
+
+/*
+TimerQueue: indexed min-heap of timed tasks with cancel and reschedule
+
+std::priority_queue can only touch its top, so a cancelled timer has to stay in the heap until it
+reaches the top (lazy deletion). With timeouts that are almost always cancelled, the heap fills up
+with dead entries. TimerQueue keeps, for every entry, its current position in the heap, so an entry
+can be removed or moved from the middle of the heap:
+•	add: O(log n); returns a TimerId (slot index + generation).
+•	cancel: O(log n); the task is destroyed right away and its slot goes back to a free list.
+•	reschedule: O(log n); sift the entry up or down in place.
+•	popDue: O(log n); moves the earliest task out (no copy).
+•	detachDue / rearm: O(log n); take a due timer out of the heap but keep its task in its slot, then
+	put it back at a new time. Periodic timers are re-armed this way, so the task is stored once and
+	never moved or reallocated between runs.
+
+Slots live in a std::deque, so a reference from task() stays valid while other timers are added.
+
+A TimerId stays valid until its timer fires or is cancelled. The generation makes a stale TimerId
+(one whose slot has been reused) harmless: cancel/reschedule on it return false.
+
+Not thread-safe: AtomicTaskScheduler guards it with its mutex.
+*/
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <utility>
+#include <vector>
+
+template <typename Task>
+class TimerQueue {
+public:
+    using Clock = std::chrono::steady_clock;
+    using TimePoint = Clock::time_point;
+
+    struct TimerId {
+        uint32_t index = 0;
+        uint32_t generation = 0; // 0 never names a live timer
+    };
+
+    TimerId add(TimePoint when, Task task) {
+        uint32_t index;
+        if (freeList_ != kNil) {
+            index = freeList_;
+            freeList_ = slots_[index].heapPos;
+        } else {
+            index = static_cast<uint32_t>(slots_.size());
+            slots_.emplace_back();
+        }
+        Slot& slot = slots_[index];
+        slot.task = std::move(task);
+        slot.heapPos = static_cast<uint32_t>(heap_.size());
+        heap_.push_back({when, index});
+        siftUp(slot.heapPos);
+        return {index, slot.generation};
+    }
+
+    bool contains(TimerId id) const {
+        return id.generation != 0 && id.index < slots_.size() && slots_[id.index].generation == id.generation;
+    }
+
+    // In the heap, as opposed to detached
+    bool pending(TimerId id) const {
+        return contains(id) && slots_[id.index].heapPos != kDetached;
+    }
+
+    // Remove a pending or detached timer and destroy its task
+    bool cancel(TimerId id) {
+        if (!contains(id)) {
+            return false;
+        }
+        if (slots_[id.index].heapPos != kDetached) {
+            removeAt(slots_[id.index].heapPos);
+        }
+        release(id.index);
+        return true;
+    }
+
+    // Cancel every pending timer whose task matches; returns how many were cancelled. O(n log n)
+    template <typename Pred>
+    std::size_t cancelIf(Pred pred) {
+        std::vector<TimerId> matches;
+        for (const HeapEntry& entry : heap_) {
+            if (pred(static_cast<const Task&>(slots_[entry.index].task))) {
+                matches.push_back({entry.index, slots_[entry.index].generation});
+            }
+        }
+        for (TimerId id : matches) {
+            cancel(id);
+        }
+        return matches.size();
+    }
+
+    // Move a pending timer to a new time
+    bool reschedule(TimerId id, TimePoint when) {
+        if (!pending(id)) {
+            return false;
+        }
+        uint32_t pos = slots_[id.index].heapPos;
+        TimePoint old = heap_[pos].when;
+        heap_[pos].when = when;
+        if (when < old) {
+            siftUp(pos);
+        } else {
+            siftDown(pos);
+        }
+        return true;
+    }
+
+    bool empty() const { return heap_.empty(); }
+    std::size_t size() const { return heap_.size(); }
+
+    // Time of the earliest timer; the queue must not be empty
+    TimePoint nextTime() const { return heap_.front().when; }
+
+    // Id of the earliest timer; the queue must not be empty
+    TimerId nextId() const {
+        uint32_t index = heap_.front().index;
+        return {index, slots_[index].generation};
+    }
+
+    // Move out the earliest task if it is due at `now`
+    bool popDue(TimePoint now, Task& out) {
+        if (heap_.empty() || heap_.front().when > now) {
+            return false;
+        }
+        uint32_t index = heap_.front().index;
+        out = std::move(slots_[index].task);
+        removeAt(0);
+        release(index);
+        return true;
+    }
+
+    // Take the earliest timer out of the heap if it is due at `now`, leaving its task in place.
+    // The timer stays valid (task(), cancel()) until it is rearm()ed or cancelled.
+    bool detachDue(TimePoint now, TimerId& id) {
+        if (heap_.empty() || heap_.front().when > now) {
+            return false;
+        }
+        uint32_t index = heap_.front().index;
+        removeAt(0);
+        slots_[index].heapPos = kDetached;
+        id = {index, slots_[index].generation};
+        return true;
+    }
+
+    // Put a detached timer back into the heap
+    bool rearm(TimerId id, TimePoint when) {
+        if (!contains(id) || slots_[id.index].heapPos != kDetached) {
+            return false;
+        }
+        slots_[id.index].heapPos = static_cast<uint32_t>(heap_.size());
+        heap_.push_back({when, id.index});
+        siftUp(slots_[id.index].heapPos);
+        return true;
+    }
+
+    // The task of a pending or detached timer; the id must be valid
+    Task& task(TimerId id) { return slots_[id.index].task; }
+
+private:
+    static constexpr uint32_t kNil = UINT32_MAX;
+    static constexpr uint32_t kDetached = UINT32_MAX - 1; // heapPos of a timer taken out by detachDue
+
+    struct HeapEntry {
+        TimePoint when;
+        uint32_t index; // Into slots_
+    };
+
+    struct Slot {
+        Task task{};
+        uint32_t heapPos = kNil;  // Position in heap_; next free slot while on the free list
+        uint32_t generation = 1;
+    };
+
+    std::vector<HeapEntry> heap_;
+    std::deque<Slot> slots_;
+    uint32_t freeList_ = kNil;
+
+    void release(uint32_t index) {
+        Slot& slot = slots_[index];
+        slot.task = Task{};
+        slot.generation = slot.generation == UINT32_MAX ? 1 : slot.generation + 1;
+        slot.heapPos = freeList_;
+        freeList_ = index;
+    }
+
+    void place(uint32_t pos, const HeapEntry& entry) {
+        heap_[pos] = entry;
+        slots_[entry.index].heapPos = pos;
+    }
+
+    void removeAt(uint32_t pos) {
+        HeapEntry last = heap_.back();
+        heap_.pop_back();
+        if (pos == heap_.size()) {
+            return;
+        }
+        TimePoint removed = heap_[pos].when;
+        place(pos, last);
+        if (last.when < removed) {
+            siftUp(pos);
+        } else {
+            siftDown(pos);
+        }
+    }
+
+    void siftUp(uint32_t pos) {
+        HeapEntry entry = heap_[pos];
+        while (pos > 0) {
+            uint32_t parent = (pos - 1) / 2;
+            if (!(entry.when < heap_[parent].when)) break;
+            place(pos, heap_[parent]);
+            pos = parent;
+        }
+        place(pos, entry);
+    }
+
+    void siftDown(uint32_t pos) {
+        HeapEntry entry = heap_[pos];
+        uint32_t n = static_cast<uint32_t>(heap_.size());
+        while (true) {
+            uint32_t child = 2 * pos + 1;
+            if (child >= n) break;
+            if (child + 1 < n && heap_[child + 1].when < heap_[child].when) ++child;
+            if (!(heap_[child].when < entry.when)) break;
+            place(pos, heap_[child]);
+            pos = child;
+        }
+        place(pos, entry);
+    }
+};
@@ -0,0 +1,352 @@
+#pragma once
+
+/*
+TimerService: one set of timer threads for the whole process, one shard per core
+
+Every Scheduler or APIScheduler used to own a thread and a mutex. With one instance per downstream
+endpoint that is thousands of threads that mostly sleep, and every producer of an instance
+serializes on its mutex. TimerService runs one timer thread ("shard") per core instead; schedulers
+become views onto it (Scheduler(TimerService&), APIScheduler), so the number of threads no longer
+grows with the number of schedulers.
+
+Submitting
+•	A producer thread is bound to one shard the first time it schedules (the shard of the CPU it runs
+	on, sched_getcpu() % shards) and gets its own single-producer/single-consumer ring into that shard.
+	schedule() is a push into that ring: no lock, no read-modify-write shared with other producers.
+•	The shard thread owns its min-heap outright, so the heap needs no lock either. It drains its rings
+	whenever it wakes.
+•	The producer wakes the shard only if it is asleep with a deadline later than the new task's due
+	time; the shard publishes that deadline (wakeAt) before sleeping. A task due after the current
+	deadline just waits in the ring until the shard wakes up anyway. If a ring is full the producer
+	wakes the shard and yields until there is room, which paces a flood of producers to the shard.
+	A shard thread must not wait for a shard (its own ring is drained only by itself, and two shards
+	could wait for each other), so when it finds a ring full it appends to the ring's overflow list
+	instead, a vector under a mutex that the shard drains with the ring. A task can therefore
+	schedule any number of follow-ups.
+
+The shard thread stores its deadline and then checks the rings; a producer pushes and then reads the
+deadline. Both sides use seq_cst fences in between, so at least one of them sees the other and no
+task is left sleeping in a ring.
+
+Groups
+A Group counts the tasks scheduled through it that have not run yet, and Group::wait() blocks until
+there are none: a view destroys itself only after its own tasks have run, as the thread-owning
+Scheduler did. The count is one atomic per group; producers of different groups share nothing.
+
+Rings are allocated once per (thread, service) and reclaimed by the shard after the thread exits.
+Tasks still pending when a TimerService is destroyed are discarded, so destroy every view (and wait
+for every Group) first; shared() lives until the program exits.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#if defined(__linux__)
+#include <sched.h>
+#endif
+#include "InplaceTask.h"
+#include "Metrics.h"
+
+class TimerService {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Task = InplaceTask<>;
+
+    static constexpr std::size_t kRingCapacity = 256;
+
+    // Tracks the tasks scheduled through it; see above
+    class Group {
+    public:
+        Group() = default;
+        Group(const Group&) = delete;
+        Group& operator=(const Group&) = delete;
+        ~Group() { wait(); }
+
+        // Block until every task scheduled through this group has run
+        void wait() {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return pending_.load(std::memory_order_acquire) == 0; });
+        }
+
+        std::size_t pending() const { return pending_.load(std::memory_order_relaxed); }
+
+    private:
+        friend class TimerService;
+
+        std::atomic<std::size_t> pending_{0};
+        std::mutex mutex_;
+        std::condition_variable cv_;
+
+        // Shard thread. Decrementing under the mutex keeps wait() from returning, and the group from
+        // being destroyed, before this function is done with it.
+        void finish() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                cv_.notify_all();
+            }
+        }
+    };
+
+    explicit TimerService(std::size_t shards = std::thread::hardware_concurrency())
+        : id_(nextId().fetch_add(1, std::memory_order_relaxed)) {
+        shards = std::max<std::size_t>(shards, 1);
+        for (std::size_t i = 0; i < shards; ++i) {
+            shards_.push_back(std::make_unique<Shard>());
+        }
+        for (auto& shard : shards_) {
+            Shard* s = shard.get();
+            s->thread = std::thread([this, s] { run(*s); });
+        }
+    }
+
+    ~TimerService() {
+        for (auto& shard : shards_) {
+            shard->stop.store(true, std::memory_order_seq_cst);
+            wake(*shard);
+        }
+        for (auto& shard : shards_) {
+            shard->thread.join();
+        }
+    }
+
+    TimerService(const TimerService&) = delete;
+    TimerService& operator=(const TimerService&) = delete;
+
+    // The process-wide service, one shard per hardware thread, started on first use
+    static TimerService& shared() {
+        static TimerService service;
+        return service;
+    }
+
+    std::size_t shards() const { return shards_.size(); }
+
+    // Run task on a shard thread at `when`; if group is given, it counts the task until it has run
+    void schedule(Task task, Clock::time_point when, Group* group = nullptr) {
+        if (group) group->pending_.fetch_add(1, std::memory_order_relaxed);
+        Local& local = localRing();
+        Entry entry{when, std::move(task), group};
+        while (!local.ring->tryPush(entry)) {
+            if (onShardThread()) {
+                local.ring->spill(std::move(entry));
+                break;
+            }
+            wake(*local.shard); // Full: make sure the shard is draining, then wait for room
+            std::this_thread::yield();
+        }
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (when.time_since_epoch().count() < local.shard->wakeAt.load(std::memory_order_relaxed)) {
+            wake(*local.shard);
+        }
+    }
+
+    template <typename Rep, typename Period>
+    void scheduleAfter(Task task, std::chrono::duration<Rep, Period> delay, Group* group = nullptr) {
+        schedule(std::move(task), Clock::now() + std::chrono::duration_cast<Clock::duration>(delay), group);
+    }
+
+private:
+    static constexpr int64_t kAwake = INT64_MIN; // wakeAt while the shard is running: nobody needs to wake it
+
+    struct Entry {
+        Clock::time_point when{};
+        Task task;
+        Group* group = nullptr;
+    };
+
+    struct Later {
+        bool operator()(const Entry& a, const Entry& b) const { return a.when > b.when; }
+    };
+
+    // Single producer (the owning thread), single consumer (the shard thread)
+    struct Ring {
+        alignas(64) std::atomic<std::size_t> head{0}; // Next slot to read; written by the shard
+        alignas(64) std::atomic<std::size_t> tail{0}; // Next slot to write; written by the producer
+        std::atomic<bool> closed{false};              // The producer thread has exited
+        Entry slots[kRingCapacity];
+
+        std::mutex overflowMutex;
+        std::vector<Entry> overflow;                  // Entries that found the ring full
+        std::atomic<bool> overflowed{false};          // overflow is not empty
+
+        bool tryPush(Entry& entry) {
+            std::size_t t = tail.load(std::memory_order_relaxed);
+            if (t - head.load(std::memory_order_acquire) == kRingCapacity) return false;
+            slots[t % kRingCapacity] = std::move(entry);
+            tail.store(t + 1, std::memory_order_release);
+            return true;
+        }
+
+        // The ring is full and the producer is a shard thread: queue the entry without waiting
+        void spill(Entry&& entry) {
+            std::lock_guard<std::mutex> lock(overflowMutex);
+            overflow.push_back(std::move(entry));
+            overflowed.store(true, std::memory_order_release);
+        }
+
+        bool empty() const {
+            return head.load(std::memory_order_relaxed) == tail.load(std::memory_order_acquire) &&
+                   !overflowed.load(std::memory_order_acquire);
+        }
+
+        // Shard thread: move every queued entry into heap
+        void drainInto(std::vector<Entry>& heap) {
+            std::size_t h = head.load(std::memory_order_relaxed);
+            std::size_t t = tail.load(std::memory_order_acquire);
+            for (; h != t; ++h) {
+                heap.push_back(std::move(slots[h % kRingCapacity]));
+                std::push_heap(heap.begin(), heap.end(), Later());
+            }
+            head.store(h, std::memory_order_release);
+            if (overflowed.load(std::memory_order_acquire)) {
+                std::lock_guard<std::mutex> lock(overflowMutex);
+                for (Entry& entry : overflow) {
+                    heap.push_back(std::move(entry));
+                    std::push_heap(heap.begin(), heap.end(), Later());
+                }
+                overflow.clear();
+                overflowed.store(false, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    struct Shard {
+        std::thread thread;
+        std::atomic<bool> stop{false};
+
+        std::mutex registryMutex; // Guards rings; taken once per producer thread, and by the shard on change
+        std::vector<std::shared_ptr<Ring>> rings;
+        std::atomic<bool> ringsChanged{false};
+
+        std::mutex sleepMutex;
+        std::condition_variable cv;
+        bool notified = false;
+        alignas(64) std::atomic<int64_t> wakeAt{kAwake}; // Deadline the sleeping shard will wake at, in Clock ticks
+    };
+
+    // A producer thread's ring into one service
+    struct Local {
+        uint64_t service;
+        Shard* shard;
+        std::shared_ptr<Ring> ring;
+    };
+
+    struct LocalRings {
+        std::vector<Local> entries;
+        ~LocalRings() {
+            for (Local& local : entries) local.ring->closed.store(true, std::memory_order_release);
+        }
+    };
+
+    const uint64_t id_; // Distinguishes services in the thread-local ring table, even at a reused address
+    std::vector<std::unique_ptr<Shard>> shards_;
+
+    // Whether the calling thread is a shard thread of any TimerService
+    static bool& onShardThread() {
+        thread_local bool shardThread = false;
+        return shardThread;
+    }
+
+    static std::atomic<uint64_t>& nextId() {
+        static std::atomic<uint64_t> id{0};
+        return id;
+    }
+
+    Local& localRing() {
+        thread_local LocalRings locals;
+        for (Local& local : locals.entries) {
+            if (local.service == id_) return local;
+        }
+        Shard* shard = shards_[homeShard()].get();
+        auto ring = std::make_shared<Ring>();
+        {
+            std::lock_guard<std::mutex> lock(shard->registryMutex);
+            shard->rings.push_back(ring);
+            shard->ringsChanged.store(true, std::memory_order_seq_cst);
+        }
+        locals.entries.push_back(Local{id_, shard, std::move(ring)});
+        return locals.entries.back();
+    }
+
+    std::size_t homeShard() const {
+#if defined(__linux__)
+        int cpu = sched_getcpu();
+        if (cpu >= 0) return static_cast<std::size_t>(cpu) % shards_.size();
+#endif
+        static std::atomic<std::size_t> next{0};
+        return next.fetch_add(1, std::memory_order_relaxed) % shards_.size();
+    }
+
+    static void wake(Shard& shard) {
+        {
+            std::lock_guard<std::mutex> lock(shard.sleepMutex);
+            shard.notified = true;
+        }
+        shard.cv.notify_one();
+    }
+
+    void run(Shard& shard) {
+        onShardThread() = true;
+        std::vector<std::shared_ptr<Ring>> rings; // The shard's copy of shard.rings
+        std::vector<Entry> heap;
+        while (true) {
+            if (shard.ringsChanged.exchange(false, std::memory_order_seq_cst)) {
+                std::lock_guard<std::mutex> lock(shard.registryMutex);
+                auto gone = [](const std::shared_ptr<Ring>& ring) {
+                    return ring->closed.load(std::memory_order_acquire) && ring->empty();
+                };
+                shard.rings.erase(std::remove_if(shard.rings.begin(), shard.rings.end(), gone), shard.rings.end());
+                rings = shard.rings;
+            }
+            bool closedRing = false;
+            for (auto& ring : rings) {
+                ring->drainInto(heap);
+                closedRing |= ring->closed.load(std::memory_order_relaxed);
+            }
+            if (closedRing) shard.ringsChanged.store(true, std::memory_order_relaxed);
+
+            auto now = Clock::now();
+            if (!heap.empty() && heap.front().when <= now) {
+                Metrics::record(Metrics::QueueDepth, heap.size());
+            }
+            while (!heap.empty() && heap.front().when <= now) {
+                std::pop_heap(heap.begin(), heap.end(), Later());
+                Entry entry = std::move(heap.back());
+                heap.pop_back();
+                Metrics::record(Metrics::Lateness, now - entry.when);
+                {
+                    Metrics::ScopedTimer timer(Metrics::Execution);
+                    entry.task();
+                }
+                entry.task.reset();
+                if (entry.group) entry.group->finish();
+            }
+            if (shard.stop.load(std::memory_order_seq_cst)) break;
+
+            // Publish the deadline, then look for work that arrived before producers could see it
+            int64_t deadline = heap.empty() ? INT64_MAX : heap.front().when.time_since_epoch().count();
+            shard.wakeAt.store(deadline, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            bool more = shard.ringsChanged.load(std::memory_order_relaxed) ||
+                        std::any_of(rings.begin(), rings.end(), [](const auto& ring) { return !ring->empty(); });
+            if (!more) {
+                std::unique_lock<std::mutex> lock(shard.sleepMutex);
+                auto woken = [&shard] { return shard.notified || shard.stop.load(std::memory_order_relaxed); };
+                if (heap.empty()) {
+                    shard.cv.wait(lock, woken);
+                } else {
+                    shard.cv.wait_until(lock, heap.front().when, woken);
+                }
+                shard.notified = false;
+                Metrics::count(Metrics::Wakeups);
+            }
+            shard.wakeAt.store(kAwake, std::memory_order_relaxed);
+        }
+    }
+};
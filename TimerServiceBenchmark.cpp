@@ -0,0 +1,129 @@
+/*
+Thread-owning Scheduler vs Scheduler views onto a shared TimerService
+
+•	threads: create S schedulers (one per downstream endpoint, say), schedule one task on each, and
+	count the threads of the process while they exist. A thread-owning Scheduler adds one thread per
+	instance; views add none, whatever S is.
+•	schedule: P producer threads each schedule N tasks, due 1 to 20ms later, on one shared scheduler.
+	Reports the producers' CPU time per schedule() (CLOCK_THREAD_CPUTIME_ID, so time spent preempted
+	or parked does not count) and the wall time until every task has run. The thread-owning
+	Scheduler serializes producers on its mutex; a view pushes into the producer's own ring.
+
+Usage: TimerServiceBenchmark [schedulers] [tasks per producer] [producers ...]
+	(default: 1000 100000 1 2 4 8)
+---
+Output on a single-core machine (numbers vary by machine):
+schedulers  kind      threads  create+destroy ms
+1000        owning       1002               40.7
+1000        view            2                1.7
+producers  kind      cpu ns/call   drain ms
+1          owning          138.1       47.2
+1          view             66.0       48.0
+8          owning          116.1      674.0
+8          view             66.8      268.5
+*/
+
+#include <time.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Scheduler.h"
+#include "TimerService.h"
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+std::atomic<uint64_t> executed{0};
+
+int threadCount() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.rfind("Threads:", 0) == 0) return std::atoi(line.c_str() + 8);
+    }
+    return -1;
+}
+
+uint64_t threadCpuNs() {
+    timespec ts{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000u + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+std::unique_ptr<Scheduler> make(bool view, TimerService& service) {
+    return view ? std::make_unique<Scheduler>(service) : std::make_unique<Scheduler>();
+}
+
+void benchThreads(const char* kind, bool view, std::size_t count, TimerService& service) {
+    auto start = Clock::now();
+    std::vector<std::unique_ptr<Scheduler>> schedulers;
+    for (std::size_t i = 0; i < count; ++i) {
+        schedulers.push_back(make(view, service));
+        schedulers.back()->schedule([] { executed.fetch_add(1, std::memory_order_relaxed); }, std::chrono::milliseconds(1));
+    }
+    int threads = threadCount();
+    schedulers.clear(); // Each destructor waits for its task
+    std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+    std::printf("%-11zu %-8s %8d %18.1f\n", count, kind, threads, elapsed.count());
+}
+
+void benchSchedule(const char* kind, bool view, int producers, std::size_t perProducer, TimerService& service) {
+    auto scheduler = make(view, service);
+    std::atomic<uint64_t> producerNs{0};
+    std::vector<std::thread> threads;
+    auto start = Clock::now();
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p] {
+            uint64_t begin = threadCpuNs();
+            for (std::size_t i = 0; i < perProducer; ++i) {
+                auto delay = std::chrono::milliseconds(1 + (i * 7 + static_cast<std::size_t>(p)) % 20);
+                scheduler->schedule([] { executed.fetch_add(1, std::memory_order_relaxed); }, delay);
+            }
+            producerNs.fetch_add(threadCpuNs() - begin);
+        });
+    }
+    for (auto& t : threads) t.join();
+    scheduler.reset(); // Waits until every task has run
+    std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+    double total = static_cast<double>(perProducer) * producers;
+    std::printf("%-10d %-8s %12.1f %10.1f\n", producers, kind, static_cast<double>(producerNs.load()) / total, elapsed.count());
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::size_t schedulers = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000;
+    std::size_t perProducer = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 100000;
+    std::vector<int> producerCounts;
+    for (int i = 3; i < argc; ++i) producerCounts.push_back(std::atoi(argv[i]));
+    if (producerCounts.empty()) producerCounts = {1, 2, 4, 8};
+
+    TimerService service;
+    std::printf("%-11s %-8s %8s %18s\n", "schedulers", "kind", "threads", "create+destroy ms");
+    benchThreads("owning", false, schedulers, service);
+    benchThreads("view", true, schedulers, service);
+
+    std::printf("%-10s %-8s %12s %10s\n", "producers", "kind", "cpu ns/call", "drain ms");
+    for (int producers : producerCounts) {
+        benchSchedule("owning", false, producers, perProducer, service);
+        benchSchedule("view", true, producers, perProducer, service);
+    }
+
+    uint64_t expected = 2 * schedulers;
+    for (int producers : producerCounts) expected += 2 * perProducer * static_cast<uint64_t>(producers);
+    if (executed.load() != expected) {
+        std::fprintf(stderr, "ran %llu tasks, expected %llu\n", static_cast<unsigned long long>(executed.load()),
+                     static_cast<unsigned long long>(expected));
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,126 @@
+/*
+Timer coalescing: scheduler wakeups and CPU with and without slack, condition variable vs timerfd
+
+N one-shot timers are scheduled up front, due at random instants spread evenly over W ms, on a
+Scheduler (heap backend) and on an AtomicTaskScheduler (tasks run inline). Each configuration runs
+with slack 0 (every timer gets its own wakeup, the old behaviour) and with 1ms and 10ms of slack,
+and waits either on the condition variable or on a timerfd (TimerWait.h).
+Reported while the timers drain (whole process, from getrusage; the main thread only sleeps):
+•	wakeups/s: voluntary context switches per second, i.e. how often the scheduler thread slept
+•	cpu %: user + system CPU time over wall time
+•	late max ms: how long after its due time the latest timer ran (should stay within the slack)
+
+Usage: TimerSlackBenchmark [timers] [window ms]   (default: 100000 1000)
+---
+Output on a single-core machine (numbers vary by machine):
+scheduler  wait      slack ms    wakeups/s    cpu %   late max ms
+Scheduler  condvar          0        13038     15.1         0.860
+Scheduler  condvar          1          738     12.5         9.069
+Scheduler  condvar         10           83      9.7        11.661
+Scheduler  timerfd          0        41211     40.8         1.433
+Scheduler  timerfd          1          722     18.4         3.929
+Scheduler  timerfd         10           83     11.1        11.340
+Atomic     condvar          0        13391     12.8         1.019
+Atomic     condvar          1          778      8.6         1.780
+Atomic     condvar         10           84      8.1        10.207
+Atomic     timerfd          0        42016     39.7         1.567
+Atomic     timerfd          1          812      8.3         6.222
+Atomic     timerfd         10           86      6.5        10.388
+Most of the CPU left at 10ms slack is the 100k tasks themselves. With no slack the condition
+variable wakes less often than the timerfd because futex waits get the kernel's 50us timer slack.
+*/
+
+#include <sys/resource.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "AtomicTaskScheduler.h"
+#include "Scheduler.h"
+#include "TimerWait.h"
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct Usage {
+    long switches;
+    double cpuSeconds;
+};
+
+Usage usage() {
+    rusage ru{};
+    getrusage(RUSAGE_SELF, &ru);
+    double cpu = static_cast<double>(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) +
+                 static_cast<double>(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+    return {ru.ru_nvcsw, cpu};
+}
+
+std::atomic<int64_t> maxLateNs{0};
+
+void record(Clock::time_point due) {
+    int64_t late = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - due).count();
+    int64_t seen = maxLateNs.load(std::memory_order_relaxed);
+    while (late > seen && !maxLateNs.compare_exchange_weak(seen, late, std::memory_order_relaxed)) {
+    }
+}
+
+template <typename Schedule>
+void measure(const char* kind, WaitMode mode, std::chrono::milliseconds slack, Schedule schedule) {
+    maxLateNs = 0;
+    Usage before{};
+    auto start = Clock::now();
+    schedule(mode, [&] {
+        before = usage();
+        start = Clock::now();
+    });
+    Usage after = usage();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    std::printf("%-10s %-8s %9lld %12.0f %8.1f %13.3f\n", kind, mode == WaitMode::TimerFd ? "timerfd" : "condvar",
+                static_cast<long long>(slack.count()), static_cast<double>(after.switches - before.switches) / seconds,
+                100.0 * (after.cpuSeconds - before.cpuSeconds) / seconds, static_cast<double>(maxLateNs.load()) / 1e6);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::size_t timers = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+    long windowMs = argc > 2 ? std::atol(argv[2]) : 1000;
+
+    // Due 100ms from now (time enough to schedule them all) plus a random offset within the window
+    std::mt19937_64 rng(42);
+    std::uniform_int_distribution<int64_t> offset(0, windowMs * 1000000);
+    std::vector<Clock::duration> delays(timers);
+    for (auto& delay : delays) delay = std::chrono::milliseconds(100) + std::chrono::nanoseconds(offset(rng));
+
+    std::printf("%-10s %-8s %9s %12s %8s %13s\n", "scheduler", "wait", "slack ms", "wakeups/s", "cpu %", "late max ms");
+    for (WaitMode mode : {WaitMode::ConditionVariable, WaitMode::TimerFd}) {
+        for (auto slack : {std::chrono::milliseconds(0), std::chrono::milliseconds(1), std::chrono::milliseconds(10)}) {
+            measure("Scheduler", mode, slack, [&](WaitMode m, auto started) {
+                Scheduler scheduler(Scheduler::Backend::Heap, m);
+                for (auto delay : delays) {
+                    // schedule() reads the clock again, so `due` may be early by a few ns
+                    scheduler.schedule([due = Clock::now() + delay] { record(due); }, delay, slack);
+                }
+                started();
+            }); // The destructor runs every timer before it returns
+        }
+    }
+    for (WaitMode mode : {WaitMode::ConditionVariable, WaitMode::TimerFd}) {
+        for (auto slack : {std::chrono::milliseconds(0), std::chrono::milliseconds(1), std::chrono::milliseconds(10)}) {
+            measure("Atomic", mode, slack, [&](WaitMode m, auto started) {
+                AtomicTaskScheduler scheduler(0, m);
+                auto now = Clock::now();
+                for (auto delay : delays) {
+                    scheduler.schedule([due = now + delay] { record(due); }, now + delay, slack);
+                }
+                started();
+            });
+        }
+    }
+    return 0;
+}
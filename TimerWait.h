@@ -0,0 +1,136 @@
+#pragma once
+
+/*
+TimerWait: how a scheduler thread sleeps until its next deadline
+
+•	WaitMode::ConditionVariable: condition_variable::wait_until, as before.
+•	WaitMode::TimerFd (Linux): the thread sleeps in poll() on a timerfd armed at the deadline
+	(TFD_TIMER_ABSTIME on CLOCK_MONOTONIC, which is steady_clock) and an eventfd that notify()
+	writes. The timerfd is re-armed only when the deadline changes, so waking up repeatedly for the
+	same deadline costs no timer syscall, and a notify() that arrives before the thread sleeps is
+	not lost: the eventfd stays readable until the thread reads it.
+Elsewhere TimerFd falls back to the condition variable.
+
+A futex wait (the condition variable) gets the thread's kernel timer slack, 50us by default
+(prctl(PR_SET_TIMERSLACK)), so the kernel already merges deadlines that are that close. A timerfd
+fires on time. It is therefore more precise but wakes up more often, unless the scheduler's own
+per-task slack coalesces the timers (TimerSlackBenchmark).
+
+The caller holds its own mutex around its state; waitUntil() releases it while sleeping, like
+condition_variable. Waits may return early (spuriously), so callers re-check their state.
+Only one thread may wait on a TimerWait at a time.
+*/
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#endif
+
+enum class WaitMode { ConditionVariable, TimerFd };
+
+class TimerWait {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit TimerWait(WaitMode mode = WaitMode::ConditionVariable) {
+#if defined(__linux__)
+        if (mode == WaitMode::TimerFd) {
+            timerFd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+            eventFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (timerFd_ < 0 || eventFd_ < 0) {
+                closeFds(); // Out of descriptors: fall back to the condition variable
+            }
+        }
+#else
+        (void)mode;
+#endif
+    }
+
+    ~TimerWait() {
+#if defined(__linux__)
+        closeFds();
+#endif
+    }
+
+    TimerWait(const TimerWait&) = delete;
+    TimerWait& operator=(const TimerWait&) = delete;
+
+    WaitMode mode() const { return timerFd_ >= 0 ? WaitMode::TimerFd : WaitMode::ConditionVariable; }
+
+    // Wake the waiting thread, or make its next wait return at once. Call after releasing the mutex.
+    void notify() {
+#if defined(__linux__)
+        if (eventFd_ >= 0) {
+            uint64_t one = 1;
+            (void)!write(eventFd_, &one, sizeof one);
+            return;
+        }
+#endif
+        cv_.notify_all();
+    }
+
+    // Release lock, sleep until `when` or notify(), and take lock again
+    void waitUntil(std::unique_lock<std::mutex>& lock, Clock::time_point when) {
+#if defined(__linux__)
+        if (timerFd_ >= 0) {
+            pollUntil(lock, when);
+            return;
+        }
+#endif
+        if (when == Clock::time_point::max()) {
+            cv_.wait(lock);
+        } else {
+            cv_.wait_until(lock, when);
+        }
+    }
+
+    void wait(std::unique_lock<std::mutex>& lock) { waitUntil(lock, Clock::time_point::max()); }
+
+private:
+    std::condition_variable cv_;
+    int timerFd_ = -1;
+    int eventFd_ = -1;
+    Clock::time_point armed_ = Clock::time_point::max(); // Deadline the timerfd is armed for; max: disarmed
+
+#if defined(__linux__)
+    void closeFds() {
+        if (timerFd_ >= 0) close(timerFd_);
+        if (eventFd_ >= 0) close(eventFd_);
+        timerFd_ = eventFd_ = -1;
+    }
+
+    void pollUntil(std::unique_lock<std::mutex>& lock, Clock::time_point when) {
+        if (when != armed_) {
+            itimerspec spec{};
+            if (when != Clock::time_point::max()) {
+                auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(when.time_since_epoch()).count();
+                ns = ns > 0 ? ns : 1; // A zero it_value would disarm the timer
+                spec.it_value.tv_sec = static_cast<time_t>(ns / 1000000000);
+                spec.it_value.tv_nsec = static_cast<long>(ns % 1000000000);
+            }
+            timerfd_settime(timerFd_, TFD_TIMER_ABSTIME, &spec, nullptr);
+            armed_ = when;
+        }
+        lock.unlock();
+        pollfd fds[2] = {{timerFd_, POLLIN, 0}, {eventFd_, POLLIN, 0}};
+        poll(fds, 2, -1); // EINTR is just an early return
+        uint64_t count;
+        if (fds[0].revents & POLLIN) {
+            (void)!read(timerFd_, &count, sizeof count);
+        }
+        if (fds[1].revents & POLLIN) {
+            (void)!read(eventFd_, &count, sizeof count);
+        }
+        lock.lock();
+        if (fds[0].revents & POLLIN) {
+            armed_ = Clock::time_point::max(); // Fired, so no longer armed
+        }
+    }
+#endif
+};
@@ -0,0 +1,254 @@
+#pragma once
+
+/*
+Hierarchical timing wheel
+
+A timing wheel stores timers in buckets ("slots") indexed by their expiry tick instead of keeping them
+sorted. The hierarchical variant stacks several wheels: level 0 has 64 slots of one tick each, level 1
+has 64 slots of 64 ticks each, and so on. A timer is placed on the lowest level whose slot can still
+tell it apart from the current time. When the current time reaches the start of a higher-level slot,
+that slot is "cascaded": its timers are re-placed on lower levels, and eventually expire from level 0.
+
+Every level keeps a 64-bit occupancy bitmap, so finding the next non-empty slot is a single
+count-trailing-zeros instead of a walk over empty slots. Time can therefore jump straight to the next
+interesting tick no matter how long the wheel has been idle.
+
+Timers further away than the wheel span (64^4 ticks, about 4.6 hours at 1ms) wait in an overflow list
+that is re-examined each time the top level wraps.
+
+Complexity
+•	Insert: O(1).
+•	Expiry: O(1) amortized; a timer is cascaded at most kLevels - 1 times.
+•	Space: O(n) nodes, recycled through a free list, plus 2 * 64 * kLevels slot indices.
+
+Timers never fire early: an expiry time is rounded up to the next tick, so a timer fires at most one
+tick late. The wheel itself is not thread-safe; callers provide their own locking.
+*/
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+template <typename T>
+class HierarchicalTimingWheel {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit HierarchicalTimingWheel(Clock::duration tick = std::chrono::milliseconds(1),
+                                     Clock::time_point origin = Clock::now())
+        : tick_(tick), origin_(origin) {
+        for (auto& level : slots_) {
+            level.fill(Slot{});
+        }
+    }
+
+    // Add a value that expires at `when`; expiry times in the past fire on the next advance()
+    void insert(Clock::time_point when, T value) {
+        uint32_t index = allocateNode(ceilTick(when), std::move(value));
+        place(index);
+        ++size_;
+    }
+
+    // Move the wheel forward to `now` and hand every expired value to fn(T&&).
+    // Returns the number of values that expired.
+    template <typename Fn>
+    std::size_t advance(Clock::time_point now, Fn&& fn) {
+        uint64_t target = floorTick(now);
+        std::size_t fired = fireList(ready_, fn);
+
+        while (now_ < target) {
+            std::optional<uint64_t> next = nextEventTick();
+            if (!next || *next > target) {
+                now_ = target;
+                break;
+            }
+            now_ = *next;
+            cascade();
+            fired += fireList(ready_, fn);
+            occupied_[0] &= ~(uint64_t{1} << (now_ & kSlotMask));
+            fired += fireList(slots_[0][now_ & kSlotMask], fn);
+        }
+        return fired;
+    }
+
+    // Time of the next tick at which advance() has work to do (an expiry or a cascade).
+    // Empty if the wheel holds no timers.
+    std::optional<Clock::time_point> nextWakeup() const {
+        if (ready_.head != kNil) {
+            return origin_ + tick_ * static_cast<Clock::rep>(now_);
+        }
+        std::optional<uint64_t> next = nextEventTick();
+        if (!next) {
+            return std::nullopt;
+        }
+        return origin_ + tick_ * static_cast<Clock::rep>(*next);
+    }
+
+    std::size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+private:
+    static constexpr unsigned kLevels = 4;
+    static constexpr unsigned kSlotBits = 6;
+    static constexpr unsigned kSlots = 1u << kSlotBits;
+    static constexpr uint64_t kSlotMask = kSlots - 1;
+    static constexpr uint32_t kNil = UINT32_MAX;
+
+    struct Node {
+        uint64_t tick;
+        uint32_t next;
+        T value;
+    };
+
+    // FIFO list of nodes, so timers sharing a tick fire in insertion order
+    struct Slot {
+        uint32_t head = kNil;
+        uint32_t tail = kNil;
+    };
+
+    Clock::duration tick_;
+    Clock::time_point origin_;
+    uint64_t now_ = 0; // Current tick, relative to origin_
+    std::size_t size_ = 0;
+
+    std::array<std::array<Slot, kSlots>, kLevels> slots_;
+    std::array<uint64_t, kLevels> occupied_{}; // Bit i set when slots_[level][i] is non-empty
+    Slot ready_;    // Timers whose tick has already been reached
+    Slot overflow_; // Timers beyond the span of the top level
+
+    std::vector<Node> nodes_;
+    uint32_t freeList_ = kNil;
+
+    uint64_t floorTick(Clock::time_point when) const {
+        if (when <= origin_) {
+            return 0;
+        }
+        return static_cast<uint64_t>((when - origin_) / tick_);
+    }
+
+    uint64_t ceilTick(Clock::time_point when) const {
+        if (when <= origin_) {
+            return 0;
+        }
+        auto elapsed = when - origin_;
+        uint64_t ticks = static_cast<uint64_t>(elapsed / tick_);
+        return (elapsed % tick_ == Clock::duration::zero()) ? ticks : ticks + 1;
+    }
+
+    uint32_t allocateNode(uint64_t tick, T&& value) {
+        if (freeList_ != kNil) {
+            uint32_t index = freeList_;
+            freeList_ = nodes_[index].next;
+            nodes_[index].tick = tick;
+            nodes_[index].next = kNil;
+            nodes_[index].value = std::move(value);
+            return index;
+        }
+        nodes_.push_back(Node{tick, kNil, std::move(value)});
+        return static_cast<uint32_t>(nodes_.size() - 1);
+    }
+
+    void append(Slot& slot, uint32_t index) {
+        nodes_[index].next = kNil;
+        if (slot.tail == kNil) {
+            slot.head = index;
+        } else {
+            nodes_[slot.tail].next = index;
+        }
+        slot.tail = index;
+    }
+
+    // Put a node on the lowest level whose slot still separates its tick from now_
+    void place(uint32_t index) {
+        uint64_t tick = nodes_[index].tick;
+        if (tick <= now_) {
+            append(ready_, index);
+            return;
+        }
+        uint64_t diff = tick ^ now_;
+        for (unsigned level = 0; level < kLevels; ++level) {
+            if ((diff >> (kSlotBits * (level + 1))) == 0) {
+                unsigned slot = static_cast<unsigned>((tick >> (kSlotBits * level)) & kSlotMask);
+                append(slots_[level][slot], index);
+                occupied_[level] |= uint64_t{1} << slot;
+                return;
+            }
+        }
+        append(overflow_, index);
+    }
+
+    // Smallest tick after now_ at which a level-0 slot expires or a higher slot cascades.
+    // A lower level always wins: its candidates lie before the next boundary of the level above.
+    std::optional<uint64_t> nextEventTick() const {
+        for (unsigned level = 0; level < kLevels; ++level) {
+            unsigned shift = kSlotBits * level;
+            unsigned current = static_cast<unsigned>((now_ >> shift) & kSlotMask);
+            uint64_t later = current == kSlotMask ? 0 : occupied_[level] & (~uint64_t{0} << (current + 1));
+            if (later != 0) {
+                uint64_t slot = static_cast<uint64_t>(__builtin_ctzll(later));
+                uint64_t base = (now_ >> (shift + kSlotBits)) << (shift + kSlotBits);
+                return base | (slot << shift);
+            }
+        }
+        if (overflow_.head != kNil) {
+            unsigned span = kSlotBits * kLevels;
+            return ((now_ >> span) + 1) << span;
+        }
+        return std::nullopt;
+    }
+
+    // Re-place the timers of every higher-level slot whose range starts at now_.
+    // Levels are handled top-down so timers can fall through several levels in one step.
+    void cascade() {
+        if ((now_ & ((uint64_t{1} << (kSlotBits * kLevels)) - 1)) == 0) {
+            Slot pending = overflow_;
+            overflow_ = Slot{};
+            replaceAll(pending);
+        }
+        for (unsigned level = kLevels - 1; level > 0; --level) {
+            unsigned shift = kSlotBits * level;
+            if ((now_ & ((uint64_t{1} << shift) - 1)) != 0) {
+                continue;
+            }
+            unsigned slot = static_cast<unsigned>((now_ >> shift) & kSlotMask);
+            if ((occupied_[level] >> slot) & 1) {
+                Slot pending = slots_[level][slot];
+                slots_[level][slot] = Slot{};
+                occupied_[level] &= ~(uint64_t{1} << slot);
+                replaceAll(pending);
+            }
+        }
+    }
+
+    void replaceAll(Slot pending) {
+        uint32_t index = pending.head;
+        while (index != kNil) {
+            uint32_t next = nodes_[index].next;
+            place(index);
+            index = next;
+        }
+    }
+
+    template <typename Fn>
+    std::size_t fireList(Slot& slot, Fn& fn) {
+        std::size_t fired = 0;
+        uint32_t index = slot.head;
+        slot = Slot{};
+        while (index != kNil) {
+            uint32_t next = nodes_[index].next;
+            T value = std::move(nodes_[index].value);
+            nodes_[index].value = T{};
+            nodes_[index].next = freeList_;
+            freeList_ = index;
+            --size_;
+            ++fired;
+            fn(std::move(value));
+            index = next;
+        }
+        return fired;
+    }
+};
@@ -0,0 +1,125 @@
+/*
+Timing wheel vs binary heap
+
+Compares the two task stores available to Scheduler (APIScheduler.cpp) without the thread and the
+std::function around them, so only the data structure is measured:
+•	Heap: std::priority_queue of (tick, id) pairs, as used by Scheduler::Backend::Heap.
+•	Wheel: HierarchicalTimingWheel<uint32_t> with 1ms ticks, as used by Scheduler::Backend::TimingWheel.
+
+Each round inserts N timers with random delays spread over one minute, then advances a simulated
+clock one millisecond at a time until every timer has expired, the way the scheduler thread drains
+its store. Insert and expiry cost are reported per timer.
+
+Usage: TimingWheelBenchmark [count ...]   (default: 10000 1000000 10000000)
+---
+Output (numbers vary by machine):
+timers     store   insert ns/op   expire ns/op
+10000      heap    ...
+10000      wheel   ...
+*/
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <queue>
+#include <random>
+#include <utility>
+#include <vector>
+#include "TimingWheel.h"
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+constexpr uint64_t kSpreadMs = 60000;
+
+struct Result {
+    double insertNs;
+    double expireNs;
+    std::size_t fired;
+};
+
+double nsPerOp(Clock::duration elapsed, std::size_t count) {
+    return std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(count);
+}
+
+Result runHeap(const std::vector<uint32_t>& delaysMs) {
+    using Entry = std::pair<uint64_t, uint32_t>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap;
+
+    auto start = Clock::now();
+    for (uint32_t id = 0; id < delaysMs.size(); ++id) {
+        heap.emplace(delaysMs[id], id);
+    }
+    auto inserted = Clock::now();
+
+    std::size_t fired = 0;
+    for (uint64_t now = 0; now <= kSpreadMs; ++now) {
+        while (!heap.empty() && heap.top().first <= now) {
+            heap.pop();
+            ++fired;
+        }
+    }
+    auto drained = Clock::now();
+    return {nsPerOp(inserted - start, delaysMs.size()), nsPerOp(drained - inserted, delaysMs.size()), fired};
+}
+
+Result runWheel(const std::vector<uint32_t>& delaysMs) {
+    const Clock::time_point origin{};
+    HierarchicalTimingWheel<uint32_t> wheel(std::chrono::milliseconds(1), origin);
+
+    auto start = Clock::now();
+    for (uint32_t id = 0; id < delaysMs.size(); ++id) {
+        wheel.insert(origin + std::chrono::milliseconds(delaysMs[id]), id);
+    }
+    auto inserted = Clock::now();
+
+    std::size_t fired = 0;
+    bool mistimed = false;
+    for (uint64_t now = 0; now <= kSpreadMs; ++now) {
+        fired += wheel.advance(origin + std::chrono::milliseconds(now), [&](uint32_t id) {
+            mistimed |= delaysMs[id] != now;
+        });
+    }
+    auto drained = Clock::now();
+    if (mistimed) {
+        std::fprintf(stderr, "wheel fired a timer at the wrong tick\n");
+        std::exit(1);
+    }
+    return {nsPerOp(inserted - start, delaysMs.size()), nsPerOp(drained - inserted, delaysMs.size()), fired};
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::vector<std::size_t> counts;
+    for (int i = 1; i < argc; ++i) {
+        counts.push_back(std::strtoull(argv[i], nullptr, 10));
+    }
+    if (counts.empty()) {
+        counts = {10000, 1000000, 10000000};
+    }
+
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<uint32_t> delay(1, kSpreadMs);
+
+    std::printf("%-10s %-7s %14s %14s\n", "timers", "store", "insert ns/op", "expire ns/op");
+    for (std::size_t count : counts) {
+        std::vector<uint32_t> delaysMs(count);
+        for (auto& d : delaysMs) {
+            d = delay(rng);
+        }
+
+        Result heap = runHeap(delaysMs);
+        Result wheel = runWheel(delaysMs);
+        if (heap.fired != count || wheel.fired != count) {
+            std::fprintf(stderr, "lost timers: heap %zu wheel %zu of %zu\n", heap.fired, wheel.fired, count);
+            return 1;
+        }
+        std::printf("%-10zu %-7s %14.1f %14.1f\n", count, "heap", heap.insertNs, heap.expireNs);
+        std::printf("%-10zu %-7s %14.1f %14.1f\n", count, "wheel", wheel.insertNs, wheel.expireNs);
+    }
+    return 0;
+}
@@ -4,12 +4,17 @@ Explanation
 •	The RateLimiter class uses a token bucket algorithm.
 •	Tokens are refilled at a constant rate (refillRate), and each API call consumes one token.
 •	If no tokens are available, the API call is delayed until tokens are refilled.
+•	reserve() books the next token and returns the exact time it becomes usable, so callers can wait for precisely that long.
 2.	APIScheduler:
 •	The scheduler integrates the RateLimiter to ensure that API calls respect the rate limit.
-•	If the rate limit is exceeded, the scheduler waits briefly and retries.
+•	If the rate limit is exceeded, the scheduler reserves the next token and waits on its condition variable until that time, so new tasks are still accepted while it waits.
+•	Priority classes: addClass(weight) adds a class (or tenant); schedule() puts a task in one (class 0, weight 1, by default). A task waits in a time-ordered heap until it is due and then in its class's FIFO for a token.
+•	Tokens go to the classes by deficit round robin: while several classes have due tasks, each gets tokens in proportion to its weight, and one class's backlog cannot starve another. A class alone gets every token, so batch traffic fills whatever capacity interactive traffic leaves.
+•	Deadlines: a task scheduled with deadlineMs is dropped (and counted by dropped()) if it has not started by then, instead of running late. A dropped task uses no token.
 3.	Main Function:
 •	Demonstrates scheduling API calls with a rate limit of 2 requests per second.
 •	Tasks are executed in order, respecting the rate limit.
+•	Then a second scheduler gets a backlog of backfill calls; interactive calls that come due later still run first, and the last backfill call misses its deadline.
 ---
 Output
 For the above code, the output will be:
@@ -17,95 +22,187 @@ API Call 1 executed!
 API Call 2 executed!
 API Call 3 executed!
 API Call 4 executed!
+Backfill 1 executed!
+Backfill 2 executed!
+Interactive 1 executed!
+Interactive 2 executed!
+Interactive 3 executed!
+Backfill 3 executed!
+Backfill 4 executed!
+Dropped: 1
 */
 
 //Second program avoid deadlock
 
 #include <iostream>
-#include <queue>
-#include <functional>
+#include <algorithm>
+#include <vector>
 #include <thread>
 #include <chrono>
 #include <mutex>
 #include <condition_variable>
+#include <deque>
+#include <stdexcept>
+#include "InplaceTask.h"
 using namespace std;
 
 class RateLimiter {
 private:
     int maxTokens; // Maximum number of tokens in the bucket
-    int tokens;    // Current number of tokens
+    int tokens;    // Current number of tokens; negative while future tokens are reserved
     int refillRate; // Tokens added per second
-    chrono::time_point<chrono::steady_clock> lastRefillTime;
+    chrono::nanoseconds refillInterval; // Time to accrue one token
+    chrono::time_point<chrono::steady_clock> lastRefillTime; // When the last whole token accrued
     mutex mtx;
 
-    // Refill tokens based on elapsed time
-    void refill() {
-        auto now = chrono::steady_clock::now();
-        auto elapsed = chrono::duration_cast<chrono::milliseconds>(now - lastRefillTime).count();
-        int newTokens = (elapsed * refillRate) / 1000; // Calculate tokens to add
-        if (newTokens > 0) {
-            tokens = min(maxTokens, tokens + newTokens);
+    // Refill tokens based on elapsed time; partial tokens carry over to the next refill
+    void refill(chrono::time_point<chrono::steady_clock> now) {
+        if (tokens >= maxTokens) {
             lastRefillTime = now;
+            return;
+        }
+        auto newTokens = (now - lastRefillTime) / refillInterval; // Whole tokens accrued
+        if (newTokens > 0) {
+            tokens = static_cast<int>(min<long long>(maxTokens, tokens + newTokens));
+            lastRefillTime = (tokens == maxTokens) ? now : lastRefillTime + newTokens * refillInterval;
         }
     }
 
 public:
     RateLimiter(int maxTokens, int refillRate)
-        : maxTokens(maxTokens), tokens(maxTokens), refillRate(refillRate), lastRefillTime(chrono::steady_clock::now()) {}
+        : maxTokens(maxTokens), tokens(maxTokens), refillRate(refillRate),
+          refillInterval(chrono::nanoseconds(1000000000LL / refillRate)), lastRefillTime(chrono::steady_clock::now()) {}
 
     // Try to consume a token; return true if successful, false otherwise
     bool tryConsume() {
         lock_guard<mutex> lock(mtx);
-        refill();
+        refill(chrono::steady_clock::now());
         if (tokens > 0) {
             tokens--;
             return true;
         }
         return false;
     }
+
+    // Book one token and return the exact time it can be used: now if one is available,
+    // otherwise the moment the next unreserved token accrues
+    chrono::time_point<chrono::steady_clock> reserve() {
+        lock_guard<mutex> lock(mtx);
+        auto now = chrono::steady_clock::now();
+        refill(now);
+        auto readyAt = (tokens > 0) ? now : lastRefillTime + (1 - tokens) * refillInterval;
+        tokens--;
+        return readyAt;
+    }
 };
 
 class APIScheduler {
+public:
+    using ClassId = size_t; // A priority class (or tenant); class 0 always exists, with weight 1
+
 private:
     struct Task {
-        function<void()> func;
+        InplaceTask<> func;
         chrono::time_point<chrono::steady_clock> executeAt;
+        ClassId cls;
+        chrono::time_point<chrono::steady_clock> deadline; // Dropped if it has not started by then
 
         bool operator>(const Task& other) const {
             return executeAt > other.executeAt;
         }
     };
 
-    priority_queue<Task, vector<Task>, greater<Task>> taskQueue;
+    struct Class {
+        size_t weight;      // Tokens the class may take per round while it has due tasks
+        size_t deficit = 0; // Tokens left in its current round; 0 between rounds
+        deque<Task> ready;  // Due tasks waiting for a token, oldest first
+
+        explicit Class(size_t weight) : weight(weight) {}
+    };
+
+    vector<Task> taskQueue; // Min-heap (push_heap / pop_heap) of tasks that are not due yet
+    deque<Class> classes; // A deque, so adding a class never moves the others' queues
+    size_t current = 0;     // Class whose round it is
+    size_t readyCount = 0;  // Due tasks over all classes
+    size_t droppedCount = 0;
     mutex mtx;
     condition_variable cv;
     bool stopScheduler = false;
     RateLimiter rateLimiter;
+    bool hasReservation = false; // A token is booked for the next due task
+    chrono::time_point<chrono::steady_clock> reservedAt; // When the booked token becomes usable
+
+    // Deficit round robin over the classes with due tasks: in its round a class takes up to `weight`
+    // tokens, and a class that runs out of due tasks forfeits the rest of its round, so an idle
+    // class saves nothing up. Tasks past their deadline are dropped here and use no token.
+    bool pickNext(chrono::time_point<chrono::steady_clock> now, InplaceTask<>& func) {
+        while (readyCount > 0) {
+            Class& c = classes[current];
+            if (c.ready.empty()) {
+                c.deficit = 0;
+                current = (current + 1) % classes.size();
+                continue;
+            }
+            Task task = move(c.ready.front());
+            c.ready.pop_front();
+            --readyCount;
+            if (now > task.deadline) {
+                ++droppedCount;
+                continue;
+            }
+            if (c.deficit == 0) {
+                c.deficit = c.weight; // Its round starts
+            }
+            if (--c.deficit == 0) {
+                current = (current + 1) % classes.size();
+            }
+            func = move(task.func);
+            return true;
+        }
+        return false;
+    }
 
     void schedulerThread() {
         while (true) {
             unique_lock<mutex> lock(mtx);
 
-            cv.wait(lock, [this]() { return !taskQueue.empty() || stopScheduler; });
+            cv.wait(lock, [this]() { return !taskQueue.empty() || readyCount > 0 || stopScheduler; });
 
-            if (stopScheduler && taskQueue.empty()) {
+            if (stopScheduler && taskQueue.empty() && readyCount == 0) {
                 break;
             }
 
+            // Due tasks leave the time-ordered heap for their class's queue; tokens are shared out
+            // among the classes from there
             auto now = chrono::steady_clock::now();
-            auto nextTask = taskQueue.top();
+            while (!taskQueue.empty() && taskQueue.front().executeAt <= now) {
+                pop_heap(taskQueue.begin(), taskQueue.end(), greater<Task>());
+                Task task = move(taskQueue.back());
+                taskQueue.pop_back();
+                classes[task.cls].ready.push_back(move(task));
+                ++readyCount;
+            }
 
-            if (now >= nextTask.executeAt) {
-                if (rateLimiter.tryConsume()) {
-                    taskQueue.pop();
-                    lock.unlock();
-                    nextTask.func();
+            if (readyCount > 0) {
+                if (!hasReservation) {
+                    reservedAt = rateLimiter.reserve();
+                    hasReservation = true;
+                }
+                InplaceTask<> func;
+                if (now >= reservedAt) {
+                    if (pickNext(now, func)) {
+                        hasReservation = false;
+                        lock.unlock();
+                        func();
+                    }
+                    // Otherwise every due task had expired; the token stays booked for the next one
                 } else {
-                    // If rate limit is exceeded, wait and retry
-                    this_thread::sleep_for(chrono::milliseconds(100));
+                    // Rate limit exceeded: wait (lock released) until the booked token is usable.
+                    // The token stays booked, and the class whose round it is then gets it.
+                    cv.wait_until(lock, reservedAt);
                 }
-            } else {
-                cv.wait_until(lock, nextTask.executeAt);
+            } else if (!taskQueue.empty()) {
+                cv.wait_until(lock, taskQueue.front().executeAt);
             }
         }
     }
@@ -113,6 +210,7 @@ private:
 public:
     APIScheduler(int maxRequestsPerSecond)
         : rateLimiter(maxRequestsPerSecond, maxRequestsPerSecond) {
+        classes.emplace_back(1);
         thread([this]() { schedulerThread(); }).detach();
     }
 
@@ -124,14 +222,40 @@ public:
         cv.notify_all();
     }
 
-    void schedule(function<void()> func, int delayMs) {
-        auto executeAt = chrono::steady_clock::now() + chrono::milliseconds(delayMs);
+    // Add a class that gets `weight` tokens for every token of a weight-1 class while both have due
+    // tasks; a class gets all the tokens the others leave unused
+    ClassId addClass(size_t weight) {
+        if (weight == 0) {
+            throw invalid_argument("APIScheduler: class weight must be at least 1");
+        }
+        lock_guard<mutex> lock(mtx);
+        classes.emplace_back(weight);
+        return classes.size() - 1;
+    }
+
+    // Run func after delayMs, in class cls. With deadlineMs > 0 the task is dropped instead if it
+    // has not started within deadlineMs of this call (0: it waits as long as it takes).
+    void schedule(InplaceTask<> func, int delayMs, ClassId cls = 0, int deadlineMs = 0) {
+        auto now = chrono::steady_clock::now();
+        auto executeAt = now + chrono::milliseconds(delayMs);
+        auto deadline = deadlineMs > 0 ? now + chrono::milliseconds(deadlineMs)
+                                       : chrono::time_point<chrono::steady_clock>::max();
         {
             lock_guard<mutex> lock(mtx);
-            taskQueue.push({func, executeAt});
+            if (cls >= classes.size()) {
+                throw invalid_argument("APIScheduler: unknown class");
+            }
+            taskQueue.push_back({move(func), executeAt, cls, deadline});
+            push_heap(taskQueue.begin(), taskQueue.end(), greater<Task>());
         }
         cv.notify_all();
     }
+
+    // Tasks dropped so far because their deadline passed before they got a token
+    size_t dropped() {
+        lock_guard<mutex> lock(mtx);
+        return droppedCount;
+    }
 };
 
 int main() {
@@ -143,8 +267,23 @@ int main() {
     scheduler.schedule([]() { cout << "API Call 3 executed!" << endl; }, 1000);
     scheduler.schedule([]() { cout << "API Call 4 executed!" << endl; }, 1500);
 
+    // Once those are done, saturate a second scheduler with backfill calls. Interactive calls that
+    // come due later still go ahead of the backlog (3 tokens for every backfill token), and a
+    // backfill call that has not started within 3.5s is dropped instead of running late.
+    APIScheduler mixed(2);
+    auto interactive = mixed.addClass(3);
+    auto backfill = mixed.addClass(1);
+    for (int i = 1; i <= 4; ++i) {
+        mixed.schedule([i]() { cout << "Backfill " << i << " executed!" << endl; }, 1900, backfill);
+    }
+    mixed.schedule([]() { cout << "Stale backfill executed!" << endl; }, 1900, backfill, 3500);
+    for (int i = 1; i <= 3; ++i) {
+        mixed.schedule([i]() { cout << "Interactive " << i << " executed!" << endl; }, 2000, interactive);
+    }
+
     // Keep the main thread alive for a while to let tasks execute
-    this_thread::sleep_for(chrono::seconds(5));
+    this_thread::sleep_for(chrono::seconds(6));
+    cout << "Dropped: " << mixed.dropped() << endl;
 
     return 0;
 }
@@ -159,6 +298,7 @@ int main() {
 #include <thread>
 #include <iostream>
 #include <vector>
+#include "Metrics.h"
 
 class RateLimiter {
 
@@ -192,6 +332,7 @@ public:
 	}
 
 	void acquire() {
+		Metrics::ScopedTimer waited(Metrics::AcquireWait);
 
 		refill();
 		{
@@ -0,0 +1,158 @@
+#pragma once
+
+/*
+TurnSequencer: "step i runs only after step i - 1", for any number of threads
+
+Generalizes LC1114's Foo (three steps) and LC1115's FooBar (two threads alternating n times): steps are
+numbered 0, 1, 2, ... and a thread runs step i with
+	sequencer.waitForTurn(i); ...; sequencer.completeTurn(i);
+or sequencer.runTurn(i, f). With P parties taking turns in a fixed cyclic order (foo/bar/baz, ...),
+party k's steps are turnOf(k, round) = round * P + k.
+
+A turn that has already come is taken at once. Otherwise waiting has three phases:
+1.	Spin on the turn counter with a CPU pause, for up to spinCutoff() iterations. The cutoff adapts
+	like folly's TurnSequencer: a wait that succeeded after s spins pulls it towards 2s, a wait that
+	had to park pulls it down to kMinSpins, with a moving average of 1/8. A handoff between threads on
+	different cores is then a couple of cache misses, and a sequencer whose turns are far apart stops
+	spinning after a few waits. On a single-core machine nothing can change the counter while we spin,
+	so this phase is skipped.
+2.	Yield a few times (more on a single core). When there are fewer cores than runnable threads this
+	hands the CPU straight to the thread whose turn it is, which is the cheapest handoff there: one
+	sched_yield per handoff, the same as a bare volatile flag polled with yield.
+3.	Park with std::atomic::wait (a futex on Linux). completeTurn() only calls notify when somebody is
+	parked, so a busy sequencer never enters the kernel; an idle one burns no CPU.
+
+The turn counter, the parked-waiter count and the spin cutoff each live on their own cache line.
+Turn numbers are 32-bit and wrap; only turns within 2^31 of the current one may be waited for.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <utility>
+
+class TurnSequencer {
+public:
+    static constexpr uint32_t kMinSpins = 16;
+    static constexpr uint32_t kMaxSpins = 4096;
+    static constexpr int kYields = 4;
+    static constexpr int kSingleCoreYields = 16;
+
+    explicit TurnSequencer(uint32_t parties = 1) : parties_(std::max<uint32_t>(parties, 1)) {}
+
+    TurnSequencer(const TurnSequencer&) = delete;
+    TurnSequencer& operator=(const TurnSequencer&) = delete;
+
+    uint32_t parties() const { return parties_; }
+
+    // The turn of party `party` (0-based position in the cycle) in round `round`
+    uint32_t turnOf(uint32_t party, uint32_t round) const { return round * parties_ + party; }
+
+    bool isTurn(uint32_t turn) const { return turn_.load(std::memory_order_acquire) == turn; }
+
+    // Block until every turn before `turn` has completed
+    void waitForTurn(uint32_t turn) {
+        if (isTurn(turn)) {
+            return; // Already ours: no spinning, no yield, and nothing learned for the cutoff
+        }
+        if (multiCore() ? spinThenYield(turn) : yieldOnly(turn)) {
+            return;
+        }
+
+        // Announce ourselves before the final check; completeTurn() stores, then checks for waiters
+        waiters_.fetch_add(1, std::memory_order_seq_cst);
+        uint32_t current;
+        while ((current = turn_.load(std::memory_order_seq_cst)) != turn) {
+            turn_.wait(current, std::memory_order_seq_cst);
+        }
+        waiters_.fetch_sub(1, std::memory_order_relaxed);
+        if (multiCore()) {
+            adapt(spinCutoff_.load(std::memory_order_relaxed), kMinSpins);
+        }
+    }
+
+    // Let the next turn run; must be called by the thread that waited for `turn`
+    void completeTurn(uint32_t turn) {
+        turn_.store(turn + 1, std::memory_order_seq_cst);
+        if (waiters_.load(std::memory_order_seq_cst) > 0) {
+            turn_.notify_all(); // Parked threads may be waiting for different turns
+        }
+    }
+
+    template <typename F>
+    void runTurn(uint32_t turn, F&& f) {
+        waitForTurn(turn);
+        Completer completer{*this, turn}; // Completes the turn even if f throws
+        std::forward<F>(f)();
+    }
+
+    uint32_t spinCutoff() const { return spinCutoff_.load(std::memory_order_relaxed); }
+
+private:
+    struct Completer {
+        TurnSequencer& sequencer;
+        uint32_t turn;
+        ~Completer() { sequencer.completeTurn(turn); }
+    };
+
+    const uint32_t parties_;
+    alignas(64) std::atomic<uint32_t> turn_{0};
+    alignas(64) std::atomic<uint32_t> waiters_{0};
+    alignas(64) std::atomic<uint32_t> spinCutoff_{kMaxSpins / 8};
+
+    // Phases 1 and 2 on a multi-core machine; true if the turn came
+    bool spinThenYield(uint32_t turn) {
+        uint32_t cutoff = spinCutoff_.load(std::memory_order_relaxed);
+        for (uint32_t spins = 0; spins < cutoff; ++spins) {
+            cpuRelax();
+            if (isTurn(turn)) {
+                adapt(cutoff, std::min(kMaxSpins, std::max(kMinSpins, 2 * spins)));
+                return true;
+            }
+        }
+        for (int i = 0; i < kYields; ++i) {
+            std::this_thread::yield();
+            if (isTurn(turn)) {
+                adapt(cutoff, kMinSpins);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Phase 2 alone on a single core, where the cutoff does not apply. Yielding is the handoff
+    // here, so it goes on longer before parking: with three or more threads the one whose turn it
+    // is may get the CPU only after the others.
+    bool yieldOnly(uint32_t turn) {
+        for (int i = 0; i < kSingleCoreYields; ++i) {
+            std::this_thread::yield();
+            if (isTurn(turn)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool multiCore() {
+        static const bool multi = std::thread::hardware_concurrency() > 1;
+        return multi;
+    }
+
+    static void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#else
+        std::this_thread::yield();
+#endif
+    }
+
+    void adapt(uint32_t previous, uint32_t target) {
+        uint32_t next = static_cast<uint32_t>(static_cast<int64_t>(previous) +
+                                              (static_cast<int64_t>(target) - static_cast<int64_t>(previous)) / 8);
+        next = std::min(kMaxSpins, std::max(kMinSpins, next));
+        if (next != previous) {
+            spinCutoff_.store(next, std::memory_order_relaxed);
+        }
+    }
+};
@@ -0,0 +1,356 @@
+#pragma once
+
+/*
+Work-stealing thread pool
+
+Each worker owns a Chase-Lev deque. The owner pushes and pops at the bottom (LIFO, no contention in
+the common case); idle workers steal from the top of other deques (FIFO, one CAS). Tasks submitted
+from outside the pool go to a shared "external" deque: its owner side is serialized by a mutex, and
+workers steal from it exactly like from each other.
+
+A worker that finds nothing to run spins through a few steal rounds, then parks on an atomic epoch
+counter with std::atomic::wait. Submitters only touch the epoch when somebody is parked, so a busy
+pool never enters the kernel on submit.
+
+The deque follows "Correct and Efficient Work-Stealing for Weak Memory Models" (Le, Pop, Cohen,
+Zappa Nardelli, PPoPP 2013). Its ring grows when full; old rings are kept until the deque is
+destroyed, because a thief may still be reading from one.
+
+Tasks are InplaceTask (InplaceTask.h), so a capture of up to 56 bytes is stored without a heap
+allocation. The deques carry pointers to task nodes; nodes are recycled, not deleted: every thread
+keeps a small cache of them and trades batches of kNodeBatch with a shared list, so once warmed up
+submit() allocates nothing, even when one thread only submits (a scheduler thread) and the workers
+only free.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <thread>
+#include <vector>
+#include "InplaceTask.h"
+
+template <typename T>
+class ChaseLevDeque {
+public:
+    explicit ChaseLevDeque(std::size_t capacity = 1024) {
+        std::size_t size = 1;
+        while (size < capacity) size <<= 1;
+        rings_.push_back(std::make_unique<Ring>(size));
+        ring_.store(rings_.back().get(), std::memory_order_relaxed);
+    }
+
+    ChaseLevDeque(const ChaseLevDeque&) = delete;
+    ChaseLevDeque& operator=(const ChaseLevDeque&) = delete;
+
+    // Owner only
+    void push(T item) {
+        int64_t b = bottom_.load(std::memory_order_relaxed);
+        int64_t t = top_.load(std::memory_order_acquire);
+        Ring* ring = ring_.load(std::memory_order_relaxed);
+        if (b - t > static_cast<int64_t>(ring->mask)) {
+            ring = grow(ring, t, b);
+        }
+        ring->put(b, item);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(b + 1, std::memory_order_relaxed);
+    }
+
+    // Owner only; takes the most recently pushed item
+    std::optional<T> pop() {
+        int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+        Ring* ring = ring_.load(std::memory_order_relaxed);
+        bottom_.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top_.load(std::memory_order_relaxed);
+
+        if (t > b) {
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return std::nullopt;
+        }
+        T item = ring->get(b);
+        if (t == b) {
+            // Last item: race the thieves for it
+            bool won = top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            if (!won) {
+                return std::nullopt;
+            }
+        }
+        return item;
+    }
+
+    // Any thread; takes the oldest item. Empty on an empty deque or a lost race.
+    std::optional<T> steal() {
+        int64_t t = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom_.load(std::memory_order_acquire);
+        if (t >= b) {
+            return std::nullopt;
+        }
+        Ring* ring = ring_.load(std::memory_order_acquire);
+        T item = ring->get(t);
+        if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return std::nullopt;
+        }
+        return item;
+    }
+
+    bool empty() const {
+        int64_t b = bottom_.load(std::memory_order_relaxed);
+        int64_t t = top_.load(std::memory_order_relaxed);
+        return b <= t;
+    }
+
+private:
+    struct Ring {
+        std::size_t mask;
+        std::unique_ptr<std::atomic<T>[]> slots;
+
+        explicit Ring(std::size_t size) : mask(size - 1), slots(new std::atomic<T>[size]) {}
+
+        T get(int64_t i) const { return slots[static_cast<std::size_t>(i) & mask].load(std::memory_order_relaxed); }
+        void put(int64_t i, T item) { slots[static_cast<std::size_t>(i) & mask].store(item, std::memory_order_relaxed); }
+    };
+
+    alignas(64) std::atomic<int64_t> top_{0};
+    alignas(64) std::atomic<int64_t> bottom_{0};
+    alignas(64) std::atomic<Ring*> ring_{nullptr};
+    std::vector<std::unique_ptr<Ring>> rings_; // Owner only; every ring ever used
+
+    Ring* grow(Ring* old, int64_t t, int64_t b) {
+        auto bigger = std::make_unique<Ring>((old->mask + 1) * 2);
+        for (int64_t i = t; i < b; ++i) {
+            bigger->put(i, old->get(i));
+        }
+        Ring* ring = bigger.get();
+        rings_.push_back(std::move(bigger));
+        ring_.store(ring, std::memory_order_release);
+        return ring;
+    }
+};
+
+class WorkStealingPool {
+public:
+    using Task = InplaceTask<>;
+
+    struct WorkerStats {
+        uint64_t executed = 0;      // Tasks run by this worker
+        uint64_t stolen = 0;        // Tasks this worker took from another deque
+        uint64_t failedSteals = 0;  // Steal attempts that came back empty
+        uint64_t parks = 0;         // Times the worker went to sleep
+    };
+
+    explicit WorkStealingPool(std::size_t workers = std::thread::hardware_concurrency()) {
+        if (workers == 0) workers = 1;
+        for (std::size_t i = 0; i < workers; ++i) {
+            workers_.push_back(std::make_unique<Worker>());
+        }
+        for (std::size_t i = 0; i < workers; ++i) {
+            workers_[i]->thread = std::thread([this, i] { run(i); });
+        }
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    // Runs every task already submitted, then joins the workers
+    ~WorkStealingPool() {
+        stop_.store(true, std::memory_order_seq_cst);
+        epoch_.fetch_add(1, std::memory_order_seq_cst);
+        epoch_.notify_all();
+        for (auto& worker : workers_) {
+            if (worker->thread.joinable()) {
+                worker->thread.join();
+            }
+        }
+    }
+
+    // Called on a worker: push to that worker's own deque. Otherwise: push to the external deque.
+    void submit(Task task) {
+        Task* item = makeNode(std::move(task));
+        if (currentPool_ == this) {
+            workers_[currentIndex_]->deque.push(item);
+        } else {
+            std::lock_guard<std::mutex> lock(externalMutex_);
+            external_.push(item);
+        }
+        wakeOne();
+    }
+
+    std::size_t size() const { return workers_.size(); }
+
+    std::vector<WorkerStats> stats() const {
+        std::vector<WorkerStats> result;
+        for (const auto& worker : workers_) {
+            WorkerStats s;
+            s.executed = worker->executed.load(std::memory_order_relaxed);
+            s.stolen = worker->stolen.load(std::memory_order_relaxed);
+            s.failedSteals = worker->failedSteals.load(std::memory_order_relaxed);
+            s.parks = worker->parks.load(std::memory_order_relaxed);
+            result.push_back(s);
+        }
+        return result;
+    }
+
+private:
+    static constexpr int kSpinRounds = 64;
+    static constexpr std::size_t kNodeBatch = 32;
+
+    struct NodeList {
+        std::mutex mutex;
+        std::vector<Task*> nodes;
+        ~NodeList() {
+            for (Task* node : nodes) delete node;
+        }
+    };
+
+    // Per-thread node cache; hands its nodes back to the shared list when the thread exits
+    struct NodeCache {
+        std::vector<Task*> nodes;
+        NodeCache() { nodes.reserve(2 * kNodeBatch); }
+        ~NodeCache() {
+            NodeList& shared = sharedNodes();
+            std::lock_guard<std::mutex> lock(shared.mutex);
+            shared.nodes.insert(shared.nodes.end(), nodes.begin(), nodes.end());
+        }
+    };
+
+    struct alignas(64) Worker {
+        ChaseLevDeque<Task*> deque;
+        std::thread thread;
+        // Written only by the owning worker; relaxed so reading stats never slows the hot path
+        std::atomic<uint64_t> executed{0};
+        std::atomic<uint64_t> stolen{0};
+        std::atomic<uint64_t> failedSteals{0};
+        std::atomic<uint64_t> parks{0};
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    ChaseLevDeque<Task*> external_;
+    std::mutex externalMutex_; // Serializes the owner side of external_
+    alignas(64) std::atomic<uint32_t> epoch_{0};
+    alignas(64) std::atomic<uint32_t> sleepers_{0};
+    std::atomic<bool> stop_{false};
+
+    static inline thread_local WorkStealingPool* currentPool_ = nullptr;
+    static inline thread_local std::size_t currentIndex_ = 0;
+    static inline thread_local NodeCache nodeCache_;
+
+    static NodeList& sharedNodes() {
+        static NodeList list;
+        return list;
+    }
+
+    static Task* makeNode(Task&& task) {
+        std::vector<Task*>& cache = nodeCache_.nodes;
+        if (cache.empty()) {
+            NodeList& shared = sharedNodes();
+            std::lock_guard<std::mutex> lock(shared.mutex);
+            std::size_t n = std::min(kNodeBatch, shared.nodes.size());
+            cache.insert(cache.end(), shared.nodes.end() - static_cast<std::ptrdiff_t>(n), shared.nodes.end());
+            shared.nodes.resize(shared.nodes.size() - n);
+        }
+        if (cache.empty()) {
+            return new Task(std::move(task));
+        }
+        Task* node = cache.back();
+        cache.pop_back();
+        *node = std::move(task);
+        return node;
+    }
+
+    static void recycleNode(Task* node) {
+        node->reset(); // Release whatever the task captured now, not when the node is reused
+        std::vector<Task*>& cache = nodeCache_.nodes;
+        cache.push_back(node);
+        if (cache.size() >= 2 * kNodeBatch) {
+            NodeList& shared = sharedNodes();
+            std::lock_guard<std::mutex> lock(shared.mutex);
+            shared.nodes.insert(shared.nodes.end(), cache.end() - static_cast<std::ptrdiff_t>(kNodeBatch), cache.end());
+            cache.resize(cache.size() - kNodeBatch);
+        }
+    }
+
+    static void bump(std::atomic<uint64_t>& counter) {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    void wakeOne() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleepers_.load(std::memory_order_seq_cst) > 0) {
+            epoch_.fetch_add(1, std::memory_order_seq_cst);
+            epoch_.notify_one();
+        }
+    }
+
+    // Try every other deque once, starting at a random victim; the external deque counts as a victim
+    Task* trySteal(std::size_t self, std::minstd_rand& rng) {
+        std::size_t victims = workers_.size() + 1;
+        std::size_t start = rng() % victims;
+        for (std::size_t k = 0; k < victims; ++k) {
+            std::size_t v = (start + k) % victims;
+            if (v == self) continue;
+            std::optional<Task*> item = (v == workers_.size()) ? external_.steal() : workers_[v]->deque.steal();
+            if (item) {
+                bump(workers_[self]->stolen);
+                return *item;
+            }
+        }
+        bump(workers_[self]->failedSteals);
+        return nullptr;
+    }
+
+    bool anyWork() const {
+        if (!external_.empty()) return true;
+        for (const auto& worker : workers_) {
+            if (!worker->deque.empty()) return true;
+        }
+        return false;
+    }
+
+    void run(std::size_t index) {
+        currentPool_ = this;
+        currentIndex_ = index;
+        Worker& self = *workers_[index];
+        std::minstd_rand rng(static_cast<unsigned>(index + 1));
+
+        while (true) {
+            Task* task = nullptr;
+            if (std::optional<Task*> own = self.deque.pop()) {
+                task = *own;
+            }
+            for (int round = 0; !task && round < kSpinRounds; ++round) {
+                task = trySteal(index, rng);
+                if (!task) std::this_thread::yield();
+            }
+            if (task) {
+                (*task)();
+                recycleNode(task);
+                bump(self.executed);
+                continue;
+            }
+
+            // Park. Announce ourselves before the final check so a concurrent submit sees us.
+            uint32_t epoch = epoch_.load(std::memory_order_seq_cst);
+            sleepers_.fetch_add(1, std::memory_order_seq_cst);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (anyWork()) {
+                sleepers_.fetch_sub(1, std::memory_order_seq_cst);
+                continue;
+            }
+            if (stop_.load(std::memory_order_seq_cst)) {
+                sleepers_.fetch_sub(1, std::memory_order_seq_cst);
+                break;
+            }
+            bump(self.parks);
+            epoch_.wait(epoch, std::memory_order_seq_cst);
+            sleepers_.fetch_sub(1, std::memory_order_seq_cst);
+        }
+    }
+};